@@ -72,8 +72,10 @@ struct CPUState {
     uint32_t wp_addr[32];
   } hbp;
 
+  uint32_t populatedSets; // Only meaningful when used as the public state.
+
 public:
-  CPUState() { clear(); }
+  CPUState() : populatedSets(kRegisterSetNone) { clear(); }
 
   inline void clear() {
     std::memset(&gp, 0, sizeof(gp));
@@ -135,6 +137,47 @@ public:
     }
   }
 
+public:
+  //
+  // Returns the register set holding the register at `ptr', as returned by
+  // get{LLDB,GDB}RegisterPtr.
+  //
+  inline RegisterSet getRegisterSet(void const *ptr) const {
+    uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
+#define _INSET(FLD)                                                            \
+  (p >= reinterpret_cast<uintptr_t>(&FLD) &&                                   \
+   p < reinterpret_cast<uintptr_t>(&FLD) + sizeof(FLD))
+    if (_INSET(gp)) {
+      return kRegisterSetGP;
+    }
+    if (_INSET(hbp)) {
+      return kRegisterSetDebug;
+    }
+#undef _INSET
+
+    return kRegisterSetFP;
+  }
+
+  //
+  // Returns the register sets in which this state differs from `other'.
+  //
+  inline uint32_t changedSets(CPUState const &other) const {
+#define _CHANGED(FLD) (std::memcmp(&FLD, &other.FLD, sizeof(FLD)) != 0)
+    uint32_t sets = kRegisterSetNone;
+    if (_CHANGED(gp)) {
+      sets |= kRegisterSetGP;
+    }
+    if (_CHANGED(vfp)) {
+      sets |= kRegisterSetFP;
+    }
+    if (_CHANGED(hbp)) {
+      sets |= kRegisterSetDebug;
+    }
+#undef _CHANGED
+
+    return sets;
+  }
+
 public:
   inline bool getLLDBRegisterPtr(int regno, void **ptr, size_t *length) const {
     if (regno >= reg_lldb_r0 && regno <= reg_lldb_r15) {
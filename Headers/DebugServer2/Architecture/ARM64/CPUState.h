@@ -92,6 +92,38 @@ public:
     }
   }
 
+public:
+  //
+  // Returns the register set holding the register at `ptr', as returned by
+  // get{LLDB,GDB}RegisterPtr.
+  //
+  inline RegisterSet getRegisterSet(void const *ptr) const {
+    uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
+    if (p >= reinterpret_cast<uintptr_t>(&gp) &&
+        p < reinterpret_cast<uintptr_t>(&gp) + sizeof(gp)) {
+      return kRegisterSetGP;
+    }
+
+    return kRegisterSetFP;
+  }
+
+  //
+  // Returns the register sets in which this state differs from `other'.
+  //
+  inline uint32_t changedSets(CPUState64 const &other) const {
+#define _CHANGED(FLD) (std::memcmp(&FLD, &other.FLD, sizeof(FLD)) != 0)
+    uint32_t sets = kRegisterSetNone;
+    if (_CHANGED(gp)) {
+      sets |= kRegisterSetGP;
+    }
+    if (_CHANGED(vfp)) {
+      sets |= kRegisterSetFP;
+    }
+#undef _CHANGED
+
+    return sets;
+  }
+
 public:
   inline bool getLLDBRegisterPtr(int regno, void **ptr, size_t *length) const {
     if (regno >= reg_lldb_x0 && regno <= reg_lldb_x30) {
@@ -140,14 +172,15 @@ public:
 //
 
 struct CPUState {
-  bool isA32; // Select which is valid between state32 and state64.
+  bool isA32;             // Select which is valid between state32 and state64.
+  uint32_t populatedSets; // RegisterSet values read into this state.
 
   union {
     CPUState32 state32;
     CPUState64 state64;
   };
 
-  CPUState() : state64() {}
+  CPUState() : populatedSets(kRegisterSetNone), state64() {}
 
   //
   // Accessors
@@ -204,6 +237,24 @@ public:
     }
   }
 
+public:
+  inline RegisterSet getRegisterSet(void const *ptr) const {
+    if (isA32) {
+      return state32.getRegisterSet(ptr);
+    } else {
+      return state64.getRegisterSet(ptr);
+    }
+  }
+
+  inline uint32_t changedSets(CPUState const &other) const {
+    if (isA32 != other.isA32) {
+      return kRegisterSetAll;
+    }
+
+    return isA32 ? state32.changedSets(other.state32)
+                 : state64.changedSets(other.state64);
+  }
+
 public:
   inline bool getLLDBRegisterPtr(int regno, void **ptr, size_t *length) const {
     if (isA32) {
@@ -8,6 +8,23 @@
 
 #include "DebugServer2/Types.h"
 
+namespace ds2 {
+namespace Architecture {
+
+//
+// Register sets that can be fetched from and written back to a thread
+// independently of each other. CPUState keeps track of the ones it holds.
+//
+enum RegisterSet : uint32_t {
+  kRegisterSetNone = 0,
+  kRegisterSetGP = (1 << 0),
+  kRegisterSetFP = (1 << 1),
+  kRegisterSetDebug = (1 << 2),
+  kRegisterSetAll = kRegisterSetGP | kRegisterSetFP | kRegisterSetDebug
+};
+} // namespace Architecture
+} // namespace ds2
+
 #define CPUSTATE_H_INTERNAL
 
 #if defined(ARCH_ARM)
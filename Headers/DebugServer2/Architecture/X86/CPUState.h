@@ -107,8 +107,10 @@ struct CPUState {
   } linux_gp;
 #endif
 
+  uint32_t populatedSets; // Only meaningful when used as the public state.
+
 public:
-  CPUState() { clear(); }
+  CPUState() : populatedSets(kRegisterSetNone) { clear(); }
 
   inline void clear() {
     std::memset(&gp, 0, sizeof(gp));
@@ -232,6 +234,58 @@ public:
   }
 #undef _REGVALUE
 
+public:
+  //
+  // Returns the register set holding the register at `ptr', as returned by
+  // get{LLDB,GDB}RegisterPtr.
+  //
+  inline RegisterSet getRegisterSet(void const *ptr) const {
+    uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
+#define _INSET(FLD)                                                            \
+  (p >= reinterpret_cast<uintptr_t>(&FLD) &&                                   \
+   p < reinterpret_cast<uintptr_t>(&FLD) + sizeof(FLD))
+    if (_INSET(gp)) {
+      return kRegisterSetGP;
+    }
+#if defined(OS_LINUX)
+    if (_INSET(linux_gp)) {
+      return kRegisterSetGP;
+    }
+#endif
+    if (_INSET(dr)) {
+      return kRegisterSetDebug;
+    }
+#undef _INSET
+
+    return kRegisterSetFP;
+  }
+
+  //
+  // Returns the register sets in which this state differs from `other'.
+  //
+  inline uint32_t changedSets(CPUState const &other) const {
+#define _CHANGED(FLD) (std::memcmp(&FLD, &other.FLD, sizeof(FLD)) != 0)
+    uint32_t sets = kRegisterSetNone;
+    if (_CHANGED(gp)) {
+      sets |= kRegisterSetGP;
+    }
+#if defined(OS_LINUX)
+    if (_CHANGED(linux_gp)) {
+      sets |= kRegisterSetGP;
+    }
+#endif
+    if (_CHANGED(x87) || _CHANGED(avx) || _CHANGED(xsave_header) ||
+        _CHANGED(xcr0)) {
+      sets |= kRegisterSetFP;
+    }
+    if (_CHANGED(dr)) {
+      sets |= kRegisterSetDebug;
+    }
+#undef _CHANGED
+
+    return sets;
+  }
+
 public:
   inline bool getLLDBRegisterPtr(int regno, void **ptr, size_t *length) const {
 #define _GETREG2(T, REG, FLD)                                                  \
@@ -303,6 +303,58 @@ public:
   }
 #undef _REGVALUE
 
+public:
+  //
+  // Returns the register set holding the register at `ptr', as returned by
+  // get{LLDB,GDB}RegisterPtr.
+  //
+  inline RegisterSet getRegisterSet(void const *ptr) const {
+    uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
+#define _INSET(FLD)                                                            \
+  (p >= reinterpret_cast<uintptr_t>(&FLD) &&                                   \
+   p < reinterpret_cast<uintptr_t>(&FLD) + sizeof(FLD))
+    if (_INSET(gp)) {
+      return kRegisterSetGP;
+    }
+#if defined(OS_LINUX)
+    if (_INSET(linux_gp)) {
+      return kRegisterSetGP;
+    }
+#endif
+    if (_INSET(dr)) {
+      return kRegisterSetDebug;
+    }
+#undef _INSET
+
+    return kRegisterSetFP;
+  }
+
+  //
+  // Returns the register sets in which this state differs from `other'.
+  //
+  inline uint32_t changedSets(CPUState64 const &other) const {
+#define _CHANGED(FLD) (std::memcmp(&FLD, &other.FLD, sizeof(FLD)) != 0)
+    uint32_t sets = kRegisterSetNone;
+    if (_CHANGED(gp)) {
+      sets |= kRegisterSetGP;
+    }
+#if defined(OS_LINUX)
+    if (_CHANGED(linux_gp)) {
+      sets |= kRegisterSetGP;
+    }
+#endif
+    if (_CHANGED(x87) || _CHANGED(eavx) || _CHANGED(xsave_header) ||
+        _CHANGED(xcr0)) {
+      sets |= kRegisterSetFP;
+    }
+    if (_CHANGED(dr)) {
+      sets |= kRegisterSetDebug;
+    }
+#undef _CHANGED
+
+    return sets;
+  }
+
 public:
   inline bool getLLDBRegisterPtr(int regno, void **ptr, size_t *length) const {
 #define _GETREG2(T, REG, FLD)                                                  \
@@ -573,14 +625,15 @@ public:
 //
 
 struct CPUState {
-  bool is32; // Select which is valid between state32 and state64.
+  bool is32;              // Select which is valid between state32 and state64.
+  uint32_t populatedSets; // RegisterSet values read into this state.
 
   union {
     CPUState32 state32;
     CPUState64 state64;
   };
 
-  CPUState() : state64() {}
+  CPUState() : populatedSets(kRegisterSetNone), state64() {}
 
   //
   // Accessors
@@ -635,6 +688,24 @@ public:
     }
   }
 
+public:
+  inline RegisterSet getRegisterSet(void const *ptr) const {
+    if (is32) {
+      return state32.getRegisterSet(ptr);
+    } else {
+      return state64.getRegisterSet(ptr);
+    }
+  }
+
+  inline uint32_t changedSets(CPUState const &other) const {
+    if (is32 != other.is32) {
+      return kRegisterSetAll;
+    }
+
+    return is32 ? state32.changedSets(other.state32)
+                : state64.changedSets(other.state64);
+  }
+
 public:
   inline bool getLLDBRegisterPtr(int regno, void **ptr, size_t *length) const {
     if (is32) {
@@ -8,6 +8,7 @@
 
 #include "DebugServer2/Target/ProcessDecl.h"
 #include "DebugServer2/Utils/Enums.h"
+#include "DebugServer2/Utils/FlatMap.h"
 
 #include <functional>
 
@@ -40,6 +41,10 @@ public:
     Mode mode;
     size_t size;
 
+    // Instruction replaced by the breakpoint opcode, for software breakpoints
+    // that are currently in memory; empty otherwise.
+    ByteVector insn;
+
   public:
     bool operator==(Site const &other) const {
       return (address == other.address) && (lifetime == other.lifetime) &&
@@ -47,8 +52,8 @@ public:
     }
   };
 
-  // Address->Site map
-  typedef std::map<uint64_t, Site> SiteMap;
+  // Address->Site map, kept sorted by address.
+  typedef Utils::FlatMap<uint64_t, Site> SiteMap;
 
 protected:
   SiteMap _sites;
@@ -96,6 +101,13 @@ public:
   virtual void enable(Target::Thread *thread = nullptr);
   virtual void disable(Target::Thread *thread = nullptr);
 
+protected:
+  // Forgets the temporary breakpoints that don't outlive a stop. If set, `cb'
+  // is called on each of them first, and a site it returns false for is
+  // kept until the next call.
+  void
+  removeExpiredSites(std::function<bool(Site const &)> const &cb = nullptr);
+
 protected:
   virtual ErrorCode enableLocation(Site const &site,
                                    Target::Thread *thread = nullptr) = 0;
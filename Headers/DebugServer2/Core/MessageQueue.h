@@ -8,34 +8,77 @@
 
 #include "DebugServer2/Base.h"
 
-#include <condition_variable>
+#include <atomic>
+#include <cstdint>
 #include <deque>
 #include <mutex>
 #include <string>
+#if !defined(OS_LINUX)
+#include <condition_variable>
+#endif
 
 namespace ds2 {
 
+//
+// Single-producer, single-consumer message queue. Messages live in a fixed
+// ring of strings that keep their capacity, so once warmed up, handing a
+// message over involves neither a lock nor an allocation. The consumer is
+// woken up through an eventfd on Linux, and a condition variable elsewhere;
+// the producer only signals it when it is actually waiting.
+//
+// put() never blocks: the producer also has to notice interrupt requests
+// while the consumer is busy. When the ring is full, messages go to an
+// overflow list under a lock, and keep going there until the consumer has
+// drained it, which preserves their order.
+//
+// put() must only be called from the producer thread, get() and wait() from
+// the consumer thread. clear() may be called from either.
+//
 class MessageQueue {
 private:
-  std::deque<std::string> _messages;
+  static size_t const kCapacity = 64;
+
+private:
+  std::string _messages[kCapacity];
+  std::atomic<size_t> _head;    // Next message to read, owned by consumer.
+  std::atomic<size_t> _tail;    // Next slot to write, owned by producer.
+  std::atomic<size_t> _discard; // Messages before this one are dropped.
+  std::atomic<bool> _waiting;
+  std::atomic<bool> _terminated;
+  std::mutex _overflowLock;
+  std::deque<std::string> _overflow; // Messages queued after a full ring.
+  std::atomic<size_t> _overflowSize;
+#if defined(OS_LINUX)
+  int _event;
+#else
   std::condition_variable _ready;
   std::mutex _lock;
-  bool _terminated;
+#endif
 
 public:
   MessageQueue();
+  ~MessageQueue();
 
 public:
   void put(std::string const &message);
   std::string get(int wait = -1); // Wait is expressed in milliseconds
 
+  // Moves the next message into `message`, swapping buffers so that neither
+  // side needs to allocate. Returns false if there was no message.
+  bool get(std::string &message, int wait = -1);
+
   // Wait until the queue is non-empty.  Returns false if
   // the queue is empty after the timeout, true otherwise.
-  // (Note that get() may still block after returning if
-  // another thread pulls from the queue.)
   bool wait(int ms = -1);
 
 public:
   void clear(bool terminating);
+
+private:
+  size_t first() const;
+  bool empty() const;
+  bool takeOverflow(std::string &message);
+  bool sleep(int ms);
+  void wake();
 };
 } // namespace ds2
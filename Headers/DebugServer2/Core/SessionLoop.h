@@ -0,0 +1,43 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+#ifndef __SessionLoop_h
+#define __SessionLoop_h
+
+#include "DebugServer2/GDBRemote/PacketProcessor.h"
+#include "DebugServer2/GDBRemote/Session.h"
+#include "DebugServer2/Host/Channel.h"
+
+#include <deque>
+
+//
+// Runs a session on the calling thread, without a SessionThread. The channel
+// is read between commands, and pump() is meant to be called by the process
+// event loop while the inferior runs (see Process::watchDescriptor()), so
+// that an interrupt is acted upon by the tracer thread as soon as it comes
+// in. Other packets received meanwhile wait for the current command to
+// complete.
+//
+class SessionLoop : public ds2::GDBRemote::PacketProcessorDelegate {
+private:
+  ds2::Host::Channel *_channel;
+  ds2::GDBRemote::Session *_session;
+  ds2::GDBRemote::PacketProcessor _pp;
+  std::deque<std::string> _pending;
+
+public:
+  SessionLoop(ds2::Host::Channel *channel, ds2::GDBRemote::Session *session);
+
+public:
+  void run();
+  bool pump();
+
+protected:
+  void onPacketData(std::string const &data, bool valid) override;
+  void onInvalidData(std::string const &data) override;
+};
+
+#endif // !__SessionLoop_h
@@ -11,7 +11,7 @@
 namespace ds2 {
 class SoftwareBreakpointManager : public BreakpointManager {
 private:
-  std::map<uint64_t, ByteVector> _insns;
+  size_t _inserted; // Number of sites whose breakpoint is in memory.
   bool _enabled;
 
 public:
@@ -33,10 +33,47 @@ protected:
   virtual ErrorCode disableLocation(Site const &site,
                                     Target::Thread *thread = nullptr) override;
 
+private:
+  //
+  // Inserts or removes the breakpoints at `addresses' (sorted, each of them
+  // in _sites). Sites are handled a page at a time: the range of each page
+  // they cover is read once, patched, and written back with a single write.
+  //
+  ErrorCode patchSites(std::vector<uint64_t> const &addresses, bool insert);
+  ErrorCode patchPage(std::vector<uint64_t>::const_iterator first,
+                      std::vector<uint64_t>::const_iterator last, bool insert);
+
 public:
   void enable(Target::Thread *thread = nullptr) override;
   void disable(Target::Thread *thread = nullptr) override;
 
+public:
+  //
+  // Breakpoints stay in memory while the inferior is stopped. removeExpired()
+  // is called on every stop instead of disable() and only takes out the
+  // temporary breakpoints; prepareStep() takes out the breakpoint a thread
+  // is about to step from, until the next resume. stepsFromSite() tells
+  // whether it would have one to take out.
+  //
+  void removeExpired();
+  ErrorCode prepareStep(Target::Thread *thread, Address const &address);
+  bool stepsFromSite(Target::Thread *thread, Address const &address) const;
+
+private:
+  ErrorCode stepAddress(Target::Thread *thread, Address const &address,
+                        Address &pc) const;
+
+public:
+  //
+  // Translate between the contents of memory and what the debugger expects
+  // to see there: maskRead() puts the original instructions back in a buffer
+  // read from `address', maskWrite() saves the bytes about to be written over
+  // a breakpoint as its new original instruction and keeps the breakpoint
+  // opcode in the buffer.
+  //
+  void maskRead(Address const &address, void *buffer, size_t length) const;
+  void maskWrite(Address const &address, void *buffer, size_t length);
+
 protected:
   ErrorCode isValid(Address const &address, size_t size,
                     Mode mode) const override;
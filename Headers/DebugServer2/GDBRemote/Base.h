@@ -20,8 +20,13 @@ enum CompatibilityMode {
   kCompatibilityModeLLDBThread
 };
 
+// The PacketSize we advertise, which also bounds the replies we build.
+static size_t const kMaxPacketSize = 0x20000;
+
 enum AttachMode { kAttachNow, kAttachAndWait, kAttachOrWait };
 
+enum CompressionType { kCompressionNone, kCompressionZlib, kCompressionLZ4 };
+
 enum BreakpointType : unsigned {
   kSoftwareBreakpoint = 0,
   kHardwareBreakpoint = 1,
@@ -13,6 +13,7 @@
 #include "DebugServer2/Target/Thread.h"
 #include "DebugServer2/Utils/MPL.h"
 
+#include <functional>
 #include <mutex>
 
 namespace ds2 {
@@ -34,6 +35,17 @@ protected:
   Session *_resumeSession;
   std::string _consoleBuffer;
 
+protected:
+  // Handed to every process we debug, see Process::watchDescriptor().
+  int _watchedFd;
+  std::function<bool()> _watchedHandler;
+
+protected:
+  // The memory-regions object is generated when it is read from offset 0, or
+  // when there is no copy of it for the current stop, and the following
+  // chunks are served from this copy.
+  std::string _memoryRegionsBuffer;
+
 public:
   DebugSessionImplBase(StringCollection const &args,
                        EnvironmentBlock const &env);
@@ -41,6 +53,9 @@ public:
   DebugSessionImplBase();
   ~DebugSessionImplBase() override;
 
+public:
+  void watchDescriptor(int fd, std::function<bool()> const &handler);
+
 protected:
   size_t getGPRSize() const override;
 
@@ -121,6 +136,9 @@ protected:
                          size_t length, ByteVector &data) override;
   ErrorCode onWriteMemory(Session &session, Address const &address,
                           ByteVector const &data, size_t &nwritten) override;
+  ErrorCode onReadMemoryVector(Session &session,
+                               MemoryRange::Collection const &ranges,
+                               std::vector<ByteVector> &data) override;
 
   ErrorCode onAllocateMemory(Session &session, size_t size,
                              uint32_t permissions, Address &address) override;
@@ -130,6 +148,17 @@ protected:
   ErrorCode onQueryMemoryRegionInfo(Session &session, Address const &address,
                                     MemoryRegionInfo &info) const override;
 
+  ErrorCode onComputeCRC(Session &session, Address const &address,
+                         size_t length, uint32_t &crc) override;
+
+  ErrorCode generateMemoryRegionsJson(std::string &json);
+
+  ErrorCode onSearch(Session &session, Address const &address, size_t length,
+                     std::string const &pattern, Address &location) override;
+  ErrorCode onSearchBackward(Session &session, Address const &address,
+                             uint32_t pattern, uint32_t mask,
+                             Address &location) override;
+
 protected:
   ErrorCode onSetEnvironmentVariable(Session &session, std::string const &name,
                                      std::string const &value) override;
@@ -163,7 +192,7 @@ protected:
 protected:
   Target::Thread *findThread(ProcessThreadId const &ptid) const;
   ErrorCode queryStopInfo(Session &session, Target::Thread *thread,
-                          StopInfo &stop) const;
+                          StopInfo &stop, bool listThreads = true) const;
   ErrorCode queryStopInfo(Session &session, ProcessThreadId const &ptid,
                           StopInfo &stop) const;
 
@@ -178,6 +207,10 @@ private:
   ErrorCode spawnProcess(StringCollection const &args,
                          EnvironmentBlock const &env);
   void appendOutput(char const *buf, size_t size);
+  void flushOutput();
+  void findLoneStep(ThreadResumeAction::Collection const &actions,
+                    ThreadResumeAction::Collection &loneStep);
+  ErrorCode prepareStep(Target::Thread *thread, Address const &address);
 };
 
 using DebugSessionImpl =
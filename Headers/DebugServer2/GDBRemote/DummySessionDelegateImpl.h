@@ -157,6 +157,9 @@ protected: // Debugging Session
                          size_t length, ByteVector &data) override;
   ErrorCode onWriteMemory(Session &session, Address const &address,
                           ByteVector const &data, size_t &nwritten) override;
+  ErrorCode onReadMemoryVector(Session &session,
+                               MemoryRange::Collection const &ranges,
+                               std::vector<ByteVector> &data) override;
 
   ErrorCode onAllocateMemory(Session &session, size_t size,
                              uint32_t permissions, Address &address) override;
@@ -168,7 +171,7 @@ protected: // Debugging Session
   ErrorCode onComputeCRC(Session &session, Address const &address,
                          size_t length, uint32_t &crc) override;
 
-  ErrorCode onSearch(Session &session, Address const &address,
+  ErrorCode onSearch(Session &session, Address const &address, size_t length,
                      std::string const &pattern, Address &location) override;
   ErrorCode onSearchBackward(Session &session, Address const &address,
                              uint32_t pattern, uint32_t mask,
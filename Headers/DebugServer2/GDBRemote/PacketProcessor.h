@@ -17,10 +17,19 @@ class PacketProcessor {
 public:
   virtual ~PacketProcessor() {}
 
+protected:
+  enum State {
+    kStateIdle,
+    kStatePayload,
+    kStateChecksumHigh,
+    kStateChecksumLow,
+  };
+
 protected:
   std::string _buffer;
-  size_t _nreqs;
-  bool _needhash;
+  State _state;
+  uint8_t _csum;
+  char _csumChars[2];
   PacketProcessorDelegate *_delegate;
 
 public:
@@ -39,9 +48,6 @@ public:
 
 private:
   void process();
-
-private:
-  bool validate();
 };
 
 struct PacketProcessorDelegate {
@@ -15,14 +15,6 @@
 namespace ds2 {
 namespace GDBRemote {
 
-template <typename T> uint8_t Checksum(T const &data) {
-  uint8_t csum = 0;
-  for (char n : data) {
-    csum += n;
-  }
-  return csum;
-}
-
 template <typename T> std::string Escape(T const &data) {
   std::ostringstream ss;
   auto first = data.begin();
@@ -44,25 +36,5 @@ template <typename T> std::string Escape(T const &data) {
 
   return ss.str();
 }
-
-template <typename T> std::string Unescape(T const &data) {
-  std::ostringstream ss;
-  auto first = data.begin();
-  auto last = data.begin();
-
-  while ((last = std::find(first, data.end(), '}')) != data.end()) {
-    while (first < last) {
-      ss << *first++;
-    }
-    ss << static_cast<char>(*(last + 1) + 0x20);
-    last += 2, first = last;
-  }
-
-  while (first < data.end()) {
-    ss << *first++;
-  }
-
-  return ss.str();
-}
 } // namespace GDBRemote
 } // namespace ds2
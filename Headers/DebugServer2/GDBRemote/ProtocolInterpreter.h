@@ -28,12 +28,17 @@ public:
     ProtocolHandler *handler;
     Callback callback;
 
-    int compare(std::string const &command) const;
+    int compare(char const *command, size_t length) const;
   };
 
 private:
   SessionBase *_session;
   Handler::Collection _handlers;
+  // Handlers whose command starts with char `c` are in _handlers, at indices
+  // [_handlerIndex[c], _handlerIndex[c + 1]).
+  size_t _handlerIndex[257];
+  // Arguments of the packet being dispatched, see dispatch().
+  std::string _argumentsBuffer;
   std::vector<std::string> _lastCommands;
 
 public:
@@ -60,8 +65,10 @@ public:
   }
 
 private:
-  Handler const *findHandler(std::string const &command,
+  Handler const *findHandler(char const *command, size_t length,
                              size_t &commandLength) const;
+  void dispatch(char const *command, size_t length, char const *arguments,
+                size_t argumentsLength);
 
 public:
   void onPacketData(std::string const &data, bool valid) override;
@@ -52,6 +52,8 @@ private:
   void Handle__M(ProtocolInterpreter::Handler const &, std::string const &);
   void Handle__m(ProtocolInterpreter::Handler const &, std::string const &);
   void Handle_M(ProtocolInterpreter::Handler const &, std::string const &);
+  void Handle_MultiMemRead(ProtocolInterpreter::Handler const &,
+                           std::string const &);
   void Handle_m(ProtocolInterpreter::Handler const &, std::string const &);
   void Handle_P(ProtocolInterpreter::Handler const &, std::string const &);
   void Handle_p(ProtocolInterpreter::Handler const &, std::string const &);
@@ -61,6 +63,8 @@ private:
                       std::string const &);
   void Handle_QDisableRandomization(ProtocolInterpreter::Handler const &,
                                     std::string const &);
+  void Handle_QEnableCompression(ProtocolInterpreter::Handler const &,
+                                 std::string const &);
   void Handle_QEnvironment(ProtocolInterpreter::Handler const &,
                            std::string const &);
   void Handle_QEnvironmentHexEncoded(ProtocolInterpreter::Handler const &,
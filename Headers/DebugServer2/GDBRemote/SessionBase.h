@@ -28,10 +28,17 @@ private:
   Host::Channel *_channel;
   PacketProcessor _processor;
   ProtocolInterpreter _interpreter;
+  std::string _sendBuffer;
+  std::string _receiveBuffer;
+  std::string _compressInput;
+  ByteVector _compressOutput;
 
 protected:
   SessionDelegate *_delegate;
   bool _ackmode;
+  bool _runLengthEncoding;
+  CompressionType _compression;
+  size_t _compressionMinSize;
   CompatibilityMode _compatMode;
 
 public:
@@ -63,40 +70,14 @@ public:
   }
 
   template <typename T> bool send(T const &data, bool escaped = false) {
-    std::ostringstream ss;
-    static std::string const searchStr = "$#}*";
-    uint8_t csum;
-
-    ss << '$';
-
-    //
-    // If data contains $, #, } or * we need to escape the
-    // stream.
-    //
-    if (!escaped &&
-        std::find_first_of(data.begin(), data.end(), searchStr.begin(),
-                           searchStr.end()) != data.end()) {
-      std::string encoded = Escape(data);
-      ss << encoded;
-      csum = Checksum(encoded);
-    } else {
-      for (char c : data) {
-        ss << c;
-      }
-      csum = Checksum(data);
-    }
-
-    ss << '#' << std::hex << std::setw(2) << std::setfill('0')
-       << (unsigned)csum;
-
-    std::string final_data = ss.str();
-    DS2LOG(Packet, "putpkt(\"%s\", %u)", final_data.c_str(),
-           (unsigned)final_data.length());
-
-    return _channel->send(final_data);
+    static_assert(sizeof(*data.data()) == 1, "packets are made of bytes");
+    return sendPacket(reinterpret_cast<char const *>(data.data()), data.size(),
+                      escaped);
   }
 
 protected:
+  bool sendPacket(char const *data, size_t length, bool escaped);
+  bool sendCompressedPacket(char const *data, size_t length, bool escaped);
   bool sendACK();
   bool sendNAK();
   inline bool sendOK() { return send("OK"); }
@@ -108,6 +89,22 @@ public:
 protected:
   inline void setAckMode(bool enabled) { _ackmode = enabled; }
 
+public:
+  inline bool getRunLengthEncoding() const { return _runLengthEncoding; }
+  inline void setRunLengthEncoding(bool enabled) {
+    _runLengthEncoding = enabled;
+  }
+
+public:
+  // Comma-separated list of the compression types we can negotiate, in the
+  // format of LLDB's SupportedCompressions feature.
+  static std::string SupportedCompressions();
+  // Returns kCompressionNone if `name` is not one of those.
+  static CompressionType GetCompressionType(std::string const &name);
+
+protected:
+  void setCompression(CompressionType type, size_t minSize);
+
 public:
   inline ProtocolInterpreter &interpreter() const {
     return const_cast<SessionBase *>(this)->_interpreter;
@@ -174,6 +174,9 @@ protected: // Debugging Session
                                  size_t length, ByteVector &data) = 0;
   virtual ErrorCode onWriteMemory(Session &session, Address const &address,
                                   ByteVector const &data, size_t &nwritten) = 0;
+  virtual ErrorCode onReadMemoryVector(Session &session,
+                                       MemoryRange::Collection const &ranges,
+                                       std::vector<ByteVector> &data) = 0;
 
   virtual ErrorCode onAllocateMemory(Session &session, size_t size,
                                      uint32_t permissions,
@@ -188,7 +191,8 @@ protected: // Debugging Session
                                  size_t length, uint32_t &crc) = 0;
 
   virtual ErrorCode onSearch(Session &session, Address const &address,
-                             std::string const &pattern, Address &location) = 0;
+                             size_t length, std::string const &pattern,
+                             Address &location) = 0;
   virtual ErrorCode onSearchBackward(Session &session, Address const &address,
                                      uint32_t pattern, uint32_t mask,
                                      Address &location) = 0;
@@ -12,6 +12,12 @@ namespace ds2 {
 namespace Host {
 
 class Channel {
+public:
+  struct Buffer {
+    void const *data;
+    size_t length;
+  };
+
 public:
   virtual ~Channel() = default;
 
@@ -24,6 +30,11 @@ public:
 public:
   virtual bool wait(int ms = -1) = 0;
 
+public:
+  // A descriptor that polls readable when receive() has data to return, or
+  // -1 if the channel cannot be waited on that way.
+  virtual int descriptor() const { return -1; }
+
 public:
   virtual ssize_t send(void const *buffer, size_t length) = 0;
   virtual ssize_t receive(void *buffer, size_t length) = 0;
@@ -31,6 +42,12 @@ public:
 public:
   virtual bool send(std::string const &buffer);
   virtual bool receive(std::string &buffer);
+
+public:
+  // Sends the concatenation of `count` buffers. Returns true once every byte
+  // has been sent, false if the channel failed, possibly after sending part
+  // of the data.
+  virtual bool sendv(Buffer const *buffers, size_t count);
 };
 } // namespace Host
 } // namespace ds2
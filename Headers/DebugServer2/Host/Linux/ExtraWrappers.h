@@ -109,6 +109,24 @@ static inline int tkill(pid_t tid, int signo) {
   return ::syscall(SYS_tkill, tid, signo);
 }
 
+// Not every libc we build with has a `memfd_create` wrapper, so we always go
+// through syscall(2).
+#if !defined(SYS_memfd_create)
+#define SYS_memfd_create __NR_memfd_create
+#endif // !SYS_memfd_create
+
+#if !defined(MFD_CLOEXEC)
+#define MFD_CLOEXEC 0x0001U
+#endif // !MFD_CLOEXEC
+
+// Headers that predate PTRACE_SEIZE (Linux 3.4) lack all of these.
+#if !defined(PTRACE_SEIZE)
+#define PTRACE_SEIZE 0x4206
+#define PTRACE_INTERRUPT 0x4207
+#define PTRACE_LISTEN 0x4208
+#define PTRACE_EVENT_STOP 128
+#endif // !PTRACE_SEIZE
+
 #if !defined(HAVE_SYS_PERSONALITY_H)
 #if !defined(SYS_personality)
 #define SYS_personality __NR_personality
@@ -16,16 +16,48 @@ namespace Linux {
 
 struct PTracePrivateData;
 
+//
+// By default, tracees are stopped with SIGSTOP, the way PTRACE_ATTACH does
+// it. In seize mode, tracees are attached with PTRACE_SEIZE instead and
+// stopped with PTRACE_INTERRUPT, which reports a PTRACE_EVENT_STOP rather
+// than a signal that has to be recognized and suppressed later on. A child
+// we spawn doesn't use PTRACE_TRACEME then: it waits for us to seize it
+// before calling exec, and reports the exec with PTRACE_EVENT_EXEC.
+//
 class PTrace : public POSIX::PTrace {
+protected:
+  static bool sSeizeMode;
+  bool _seize;
+  int _seizeGate[2];
+
+public:
+  PTrace();
+  ~PTrace() override;
+
+public:
+  static void SetSeizeMode(bool enable);
+  inline bool seizing() const { return _seize; }
+
 public:
   ErrorCode wait(ProcessThreadId const &ptid, int *status = nullptr) override;
 
 public:
+  ErrorCode prepareTraceMe();
   ErrorCode traceMe(bool disableASLR) override;
   ErrorCode traceThat(ProcessId pid) override;
 
+public:
+  ErrorCode attach(ProcessId pid) override;
+  ErrorCode seize(ProcessId pid);
+
+protected:
+  unsigned long traceOptions() const;
+  void closeSeizeGate();
+
 public:
   ErrorCode kill(ProcessThreadId const &ptid, int signal) override;
+  ErrorCode suspend(ProcessThreadId const &ptid) override;
+  ErrorCode listen(ProcessThreadId const &ptid);
 
 protected:
   virtual ErrorCode readBytes(ProcessThreadId const &ptid,
@@ -48,6 +80,14 @@ public:
                          Architecture::CPUState &state) override;
   ErrorCode writeCPUState(ProcessThreadId const &ptid, ProcessInfo const &pinfo,
                           Architecture::CPUState const &state) override;
+  ErrorCode readCPUStateSets(ProcessThreadId const &ptid,
+                             ProcessInfo const &pinfo,
+                             Architecture::CPUState &state,
+                             uint32_t sets) override;
+  ErrorCode writeCPUStateSets(ProcessThreadId const &ptid,
+                              ProcessInfo const &pinfo,
+                              Architecture::CPUState const &state,
+                              uint32_t sets) override;
 
 private:
   ErrorCode prepareAddressForResume(ProcessThreadId const &ptid,
@@ -0,0 +1,117 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+#pragma once
+
+#include "DebugServer2/Host/Channel.h"
+#include "DebugServer2/Host/Socket.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+//
+// A channel for clients running on the same host, made of two
+// single-producer single-consumer byte rings in a shared memory segment.
+//
+// The client connects to a UNIX socket and receives a single byte along with
+// five descriptors (SCM_RIGHTS): a memfd holding a Header followed by the two
+// rings at dataOffset and dataOffset + ringSize, then for each ring an eventfd
+// signalled when data is produced and one signalled when data is consumed.
+// The client produces into rings[kClientToServer] and consumes from
+// rings[kServerToClient].
+//
+// Positions are free-running byte counts: writePos is where the producer
+// writes next and readPos where the consumer reads next, so a ring holds
+// writePos - readPos bytes. A side that is about to sleep sets its waiting
+// flag and re-checks the ring before blocking on the eventfd; the other side
+// signals the eventfd after moving a position if the flag is set. Closing the
+// socket ends the session, and so does a ring that seems to hold more than
+// ringSize bytes. Support/Benchmarks/SharedMemoryClient.h is a reference
+// client.
+//
+// Each ring has a single consumer and a single producer on either side. On
+// our side, replies and acknowledgements may be sent from different threads,
+// so sending is serialized, and closing the channel only shuts the socket
+// down; the descriptor stays valid for the other thread until we go away.
+//
+class SharedMemoryChannel : public Channel,
+                            public make_unique_enabler<SharedMemoryChannel> {
+public:
+  static uint32_t const kMagic = 0x53325344; // 'DS2S'
+  static uint32_t const kVersion = 1;
+  static uint32_t const kRingSize = 1 << 20;
+  static uint32_t const kDataOffset = 4096;
+
+  enum { kClientToServer, kServerToClient };
+  enum { kEventProduced, kEventConsumed };
+
+  struct Ring {
+    alignas(64) std::atomic<uint32_t> writePos; // Moved by the producer.
+    std::atomic<uint32_t> readerWaiting;
+    alignas(64) std::atomic<uint32_t> readPos; // Moved by the consumer.
+    std::atomic<uint32_t> writerWaiting;
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ringSize;
+    uint32_t dataOffset;
+    Ring rings[2];
+  };
+
+protected:
+  std::unique_ptr<Socket> _socket;
+  std::atomic<bool> _closed;
+  std::mutex _sendLock;
+  Header *_header;
+  size_t _mapSize;
+  int _events[2][2];
+  Ring *_input;
+  Ring *_output;
+  uint8_t *_inputData;
+  uint8_t *_outputData;
+
+protected:
+  SharedMemoryChannel(std::unique_ptr<Socket> socket);
+
+public:
+  ~SharedMemoryChannel() override;
+
+public:
+  static std::unique_ptr<SharedMemoryChannel>
+  Create(std::unique_ptr<Socket> socket);
+
+protected:
+  bool initialize();
+
+public:
+  void close() override;
+
+public:
+  bool connected() const override;
+
+public:
+  bool wait(int ms = -1) override;
+
+public:
+  ssize_t send(void const *buffer, size_t length) override;
+  ssize_t receive(void *buffer, size_t length) override;
+  bool sendv(Buffer const *buffers, size_t count) override;
+
+protected:
+  bool sleep(int event, std::atomic<uint32_t> &flag, int ms);
+  void signal(int event, std::atomic<uint32_t> const &flag);
+  bool checkPositions(uint32_t readPos, uint32_t writePos);
+};
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
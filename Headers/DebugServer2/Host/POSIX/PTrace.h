@@ -58,6 +58,21 @@ public:
                                   ProcessInfo const &info,
                                   Architecture::CPUState const &state) = 0;
 
+public:
+  //
+  // Same as readCPUState/writeCPUState, but only transfers the register sets
+  // in `sets' (a mask of Architecture::RegisterSet values). The default
+  // implementations transfer everything.
+  //
+  virtual ErrorCode readCPUStateSets(ProcessThreadId const &ptid,
+                                     ProcessInfo const &info,
+                                     Architecture::CPUState &state,
+                                     uint32_t sets);
+  virtual ErrorCode writeCPUStateSets(ProcessThreadId const &ptid,
+                                      ProcessInfo const &info,
+                                      Architecture::CPUState const &state,
+                                      uint32_t sets);
+
 public:
   virtual ErrorCode suspend(ProcessThreadId const &ptid);
 
@@ -50,6 +50,7 @@ protected:
   int _signalCode;
   ProcessId _pid;
   bool _shell;
+  bool _manualRedirection;
 
 public:
   ProcessSpawner();
@@ -113,8 +114,19 @@ public:
   ErrorCode input(ByteVector const &buf);
   inline std::string const &output() const { return _outputBuffer; }
 
+public:
+  // When enabled before run(), output redirected to delegates is not read by
+  // a separate thread; instead the caller watches redirectionFd() and calls
+  // pumpRedirection() when it becomes readable.
+  inline void setManualRedirection(bool enabled) {
+    _manualRedirection = enabled;
+  }
+  int redirectionFd() const;
+  bool pumpRedirection();
+
 private:
   void redirectionThread();
+  void closeRedirection();
 };
 } // namespace Host
 } // namespace ds2
@@ -46,6 +46,7 @@ public:
   ssize_t receive(void *buffer, size_t length) override;
 
 public:
+  bool sendv(Buffer const *buffers, size_t count) override;
   bool receive(std::string &buffer) override;
 };
 } // namespace Host
@@ -45,6 +45,9 @@ public:
 
 public:
   inline bool valid() const { return (_handle != INVALID_SOCKET); }
+#if defined(OS_POSIX)
+  inline int handle() const { return _handle; }
+#endif
 
 public:
   inline bool listening() const { return (_state == State::Listening); }
@@ -75,6 +78,9 @@ public:
 
 public:
   bool wait(int ms = -1) override;
+#if defined(OS_POSIX)
+  inline int descriptor() const override { return _handle; }
+#endif
 
 public:
   bool setNonBlocking();
@@ -82,6 +88,10 @@ public:
 public:
   ssize_t send(void const *buffer, size_t length) override;
   ssize_t receive(void *buffer, size_t length) override;
+#if defined(OS_POSIX)
+  bool sendv(Buffer const *buffers, size_t count) override;
+  bool sendDescriptors(int const *fds, size_t count);
+#endif
 };
 } // namespace Host
 } // namespace ds2
@@ -9,6 +9,9 @@
 #include "DebugServer2/Host/Linux/PTrace.h"
 #include "DebugServer2/Target/POSIX/ELFProcess.h"
 
+#include <functional>
+#include <mutex>
+
 namespace ds2 {
 namespace Target {
 namespace Linux {
@@ -16,17 +19,51 @@ namespace Linux {
 class Process : public POSIX::ELFProcess {
 protected:
   Host::Linux::PTrace _ptrace;
+  int _memFd;
+  MemoryRegionInfo::Collection _memoryRegions;
+  bool _memoryRegionsValid;
+  Host::ProcessSpawner *_spawner;
+  int _epollFd;
+  int _signalFd;
+  int _redirectionFd;
+  int _watchedFd;
+  std::function<bool()> _watchedHandler;
+  // Guards the two members below, which interrupt() uses from the session
+  // thread.
+  std::mutex _interruptLock;
+  int _interruptFd;
+  ThreadId _interruptedTid;
+
+public:
+  Process();
+  ~Process() override;
 
 protected:
+  ErrorCode initialize(ProcessId pid, uint32_t flags) override;
   ErrorCode attach(int waitStatus) override;
+  void attachThreads(int mainStatus);
+  void recordAttachStop(Thread *thread, int status);
+  void cleanup() override;
+  void prepareSpawner(Host::ProcessSpawner &spawner) override;
 
 public:
+  ErrorCode interrupt() override;
+  ErrorCode suspend() override;
   ErrorCode terminate() override;
   bool isAlive() const override;
 
 public:
   ErrorCode getMemoryRegionInfo(Address const &address,
                                 MemoryRegionInfo &info) override;
+  ErrorCode enumerateMemoryRegions(
+      std::function<void(MemoryRegionInfo const &)> const &cb) override;
+
+public:
+  using POSIX::ELFProcess::invalidateMemoryCache;
+  void invalidateMemoryCache() override;
+
+protected:
+  ErrorCode updateMemoryRegions();
 
 protected:
   ErrorCode executeCode(ByteVector const &codestr, uint64_t &result);
@@ -36,6 +73,12 @@ public:
                        size_t *count = nullptr) override;
   ErrorCode writeMemory(Address const &address, void const *data, size_t length,
                         size_t *count = nullptr) override;
+  ErrorCode readMemoryVector(MemoryRange::Collection const &ranges,
+                             std::vector<ByteVector> &buffers) override;
+
+protected:
+  int memoryFd();
+  void closeMemoryFd();
 
 public:
   ErrorCode allocateMemory(size_t size, uint32_t protection,
@@ -47,6 +90,21 @@ protected:
 
 public:
   ErrorCode wait() override;
+  bool watchDescriptor(int fd, std::function<bool()> const &handler) override;
+
+protected:
+  void recordSuspendEvent(ThreadId tid, int status);
+  void waitForLeaderSuspend();
+
+protected:
+  bool setupEventLoop();
+  void closeEventLoop();
+  void pumpRedirection();
+  void pumpWatchedDescriptor();
+  void interruptRunningThread();
+  bool answersInterrupt(ThreadId tid);
+  void clearInterrupt();
+  ThreadId waitForEvent(int *status);
 
 public:
   Host::Linux::PTrace &ptrace() const override;
@@ -15,13 +15,27 @@ namespace Target {
 namespace Linux {
 
 class Thread : public ds2::Target::POSIX::Thread {
+protected:
+  // Set when the last stop was a group-stop (seize mode only); see resume().
+  bool _groupStopped;
+
 protected:
   friend class Process;
   Thread(Process *process, ThreadId tid);
 
+public:
+  ErrorCode suspend() override;
+  ErrorCode resume(int signal = 0, Address const &address = Address()) override;
+
 protected:
   ErrorCode updateStopInfo(int waitStatus) override;
   void updateState() override;
+
+public:
+  bool reconcileState();
+
+protected:
+  bool isZombieLeader() const;
 };
 } // namespace Linux
 } // namespace Target
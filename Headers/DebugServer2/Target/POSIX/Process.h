@@ -21,6 +21,7 @@ protected:
 protected:
   ErrorCode initialize(ProcessId pid, uint32_t flags) override;
   virtual ErrorCode attach(int waitStatus) = 0;
+  virtual void prepareSpawner(Host::ProcessSpawner &spawner) {}
 
 public:
   ErrorCode detach() override;
@@ -13,12 +13,22 @@ namespace Target {
 namespace POSIX {
 
 class Thread : public ds2::Target::ThreadBase {
+protected:
+  // Register state of the thread. Each register set is fetched the first
+  // time it is needed after a stop (see _cpuState.populatedSets) and stays
+  // valid until the thread is resumed or stepped.
+  Architecture::CPUState _cpuState;
+
 protected:
   Thread(ds2::Target::Process *process, ThreadId tid);
 
 public:
   ErrorCode readCPUState(Architecture::CPUState &state) override;
   ErrorCode writeCPUState(Architecture::CPUState const &state) override;
+  ErrorCode readCPUStateSets(Architecture::CPUState &state,
+                             uint32_t sets) override;
+  ErrorCode writeCPUStateSets(Architecture::CPUState const &state,
+                              uint32_t sets) override;
 
 public:
   ErrorCode terminate() override;
@@ -28,6 +38,9 @@ public:
   ErrorCode step(int signal = 0, Address const &address = Address()) override;
   ErrorCode resume(int signal = 0, Address const &address = Address()) override;
 
+protected:
+  void invalidateCPUState();
+
 protected:
   virtual ErrorCode updateStopInfo(int waitStatus);
 };
@@ -12,6 +12,7 @@
 #include "DebugServer2/Target/ThreadBase.h"
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <set>
 
@@ -35,6 +36,16 @@ protected:
   mutable std::unique_ptr<SoftwareBreakpointManager> _softwareBreakpointManager;
   mutable std::unique_ptr<HardwareBreakpointManager> _hardwareBreakpointManager;
 
+protected:
+  //
+  // Pages read by readMemoryBuffer() during the current stop, keyed by page
+  // address. The contents are the raw process memory, with software
+  // breakpoint opcodes left in place.
+  //
+  std::map<uint64_t, ByteVector> _memoryCache;
+  uint64_t _memoryCacheHits;
+  uint64_t _memoryCacheMisses;
+
 protected:
   ProcessBase();
   virtual ~ProcessBase();
@@ -93,6 +104,8 @@ public:
                                size_t length, size_t *nread = nullptr) = 0;
   virtual ErrorCode writeMemory(Address const &address, void const *buffer,
                                 size_t length, size_t *nwritten = nullptr) = 0;
+  virtual ErrorCode readMemoryVector(MemoryRange::Collection const &ranges,
+                                     std::vector<ByteVector> &buffers);
 
 public:
   virtual ErrorCode enumerateSharedLibraries(
@@ -107,10 +120,33 @@ public:
                               size_t *nwritten = nullptr);
   ErrorCode writeMemoryBuffer(Address const &address, ByteVector const &buffer,
                               size_t length, size_t *nwritten = nullptr);
+  ErrorCode readMemoryBuffers(MemoryRange::Collection const &ranges,
+                              std::vector<ByteVector> &buffers);
+
+public:
+  virtual void invalidateMemoryCache();
+  void invalidateMemoryCache(Address const &address, size_t length);
+  inline uint64_t memoryCacheHits() const { return _memoryCacheHits; }
+  inline uint64_t memoryCacheMisses() const { return _memoryCacheMisses; }
+
+protected:
+  ErrorCode readMemoryCached(uint64_t address, size_t length,
+                             ByteVector &buffer, bool fill = true);
 
 public:
   virtual ErrorCode wait() = 0;
 
+public:
+  //
+  // Asks wait() to also watch `fd` and to call `handler` from the waiting
+  // thread whenever it becomes readable; the descriptor is dropped once the
+  // handler returns false. Pass -1 to stop watching. Returns false if the
+  // platform cannot do it.
+  //
+  virtual bool watchDescriptor(int, std::function<bool()> const &) {
+    return false;
+  }
+
 public:
   virtual ErrorCode allocateMemory(size_t size, uint32_t protection,
                                    uint64_t *address) = 0;
@@ -119,6 +155,8 @@ public:
 public:
   virtual ErrorCode getMemoryRegionInfo(Address const &address,
                                         MemoryRegionInfo &info) = 0;
+  virtual ErrorCode enumerateMemoryRegions(
+      std::function<void(MemoryRegionInfo const &)> const &cb);
 
 public:
   virtual void getThreadIds(std::vector<ThreadId> &tids);
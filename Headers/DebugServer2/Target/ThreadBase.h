@@ -57,12 +57,26 @@ public:
 public:
   virtual ErrorCode readCPUState(Architecture::CPUState &state) = 0;
   virtual ErrorCode writeCPUState(Architecture::CPUState const &state) = 0;
+  // Only the register sets in `sets' are guaranteed to be read or written;
+  // targets that can't transfer them separately transfer everything.
+  virtual ErrorCode readCPUStateSets(Architecture::CPUState &state,
+                                     uint32_t sets);
+  virtual ErrorCode writeCPUStateSets(Architecture::CPUState const &state,
+                                      uint32_t sets);
   virtual ErrorCode modifyRegisters(
       std::function<void(Architecture::CPUState &state)> action) final;
 
 public:
   inline uint32_t core() const { return _stopInfo.core; }
 
+public:
+  // Targets that track thread state from debug events, rather than asking
+  // the system on every enumeration, cross-check it when this is enabled.
+  static void SetStateChecking(bool enabled) { sStateChecking = enabled; }
+
+protected:
+  static bool sStateChecking;
+
 protected:
   friend class ProcessBase;
   virtual void updateState() = 0;
@@ -339,6 +339,17 @@ struct MemoryRegionInfo {
   }
 };
 
+struct MemoryRange {
+  typedef std::vector<MemoryRange> Collection;
+
+  Address start;
+  uint64_t length;
+
+  MemoryRange() : start(), length(0) {}
+  MemoryRange(Address const &start_, uint64_t length_)
+      : start(start_), length(length_) {}
+};
+
 struct SharedLibraryInfo {
   std::string path;
   bool main;
@@ -0,0 +1,26 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ds2 {
+namespace Utils {
+
+//
+// CRC-32 as computed by GDB for qCRC: polynomial 0x04c11db7, most significant
+// bit first, no final inversion. Start with 0xffffffff and feed the result of
+// each call to the next one to checksum data in pieces.
+//
+// CRC32 uses carry-less multiplications when the CPU has them; CRC32Scalar
+// is the table-driven version it falls back to.
+//
+uint32_t CRC32(uint32_t crc, void const *data, size_t length);
+uint32_t CRC32Scalar(uint32_t crc, void const *data, size_t length);
+} // namespace Utils
+} // namespace ds2
@@ -0,0 +1,88 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+// A subset of the std::map interface on top of a sorted std::vector. Lookups
+// are binary searches and walking the elements in order is cache friendly,
+// at the price of linear-time insertion and removal. Unlike with std::map,
+// insertion and removal invalidate iterators and references.
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace ds2 {
+namespace Utils {
+
+template <typename Key, typename T> class FlatMap {
+public:
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef std::pair<Key, T> value_type;
+  typedef typename std::vector<value_type>::iterator iterator;
+  typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+public:
+  inline iterator begin() { return _elements.begin(); }
+  inline iterator end() { return _elements.end(); }
+  inline const_iterator begin() const { return _elements.begin(); }
+  inline const_iterator end() const { return _elements.end(); }
+
+public:
+  inline size_t size() const { return _elements.size(); }
+  inline bool empty() const { return _elements.empty(); }
+  inline void clear() { _elements.clear(); }
+
+public:
+  inline iterator lower_bound(Key const &key) {
+    return std::lower_bound(_elements.begin(), _elements.end(), key, compare);
+  }
+
+  inline const_iterator lower_bound(Key const &key) const {
+    return std::lower_bound(_elements.begin(), _elements.end(), key, compare);
+  }
+
+  inline iterator find(Key const &key) {
+    auto it = lower_bound(key);
+    return (it != end() && it->first == key) ? it : end();
+  }
+
+  inline const_iterator find(Key const &key) const {
+    auto it = lower_bound(key);
+    return (it != end() && it->first == key) ? it : end();
+  }
+
+  inline T &operator[](Key const &key) {
+    auto it = lower_bound(key);
+    if (it == end() || it->first != key) {
+      it = _elements.insert(it, value_type(key, T()));
+    }
+    return it->second;
+  }
+
+public:
+  inline iterator erase(iterator it) { return _elements.erase(it); }
+
+  inline size_t erase(Key const &key) {
+    auto it = find(key);
+    if (it == end()) {
+      return 0;
+    }
+    _elements.erase(it);
+    return 1;
+  }
+
+private:
+  static inline bool compare(value_type const &element, Key const &key) {
+    return element.first < key;
+  }
+
+private:
+  std::vector<value_type> _elements;
+};
+} // namespace Utils
+} // namespace ds2
@@ -34,29 +34,44 @@ static inline uint8_t HexToByte(char const *chars) {
   return (HexToNibble(chars[0]) << 4) | HexToNibble(chars[1]);
 }
 
+//
+// Bulk conversions, vectorized where the target allows it. HexEncode writes
+// 2 * length lowercase hex chars for the `length` bytes at `data`; HexDecode
+// reads 2 * length hex chars and writes `length` bytes.
+//
+void HexEncode(char *out, void const *data, size_t length);
+void HexDecode(void *out, char const *chars, size_t length);
+
+// The plain loops the vectorized versions fall back to.
+void HexEncodeScalar(char *out, void const *data, size_t length);
+void HexDecodeScalar(void *out, char const *chars, size_t length);
+
 template <typename T> static inline std::string ToHex(T const &vec) {
-  std::string result;
-  for (char n : vec) {
-    result += NibbleToHex(n >> 4);
-    result += NibbleToHex(n & 0x0f);
+  std::string result(vec.size() * 2, '\0');
+  if (!vec.empty()) {
+    HexEncode(&result[0], &vec[0], vec.size());
   }
   return result;
 }
 
-static inline ByteVector HexToByteVector(std::string const &str) {
-  ByteVector result;
-  DS2ASSERT(str.size() % 2 == 0);
-  for (size_t n = 0; n < str.size(); n += 2) {
-    result.emplace_back(HexToByte(&str[n]));
+static inline ByteVector HexToByteVector(char const *str, size_t length) {
+  DS2ASSERT(length % 2 == 0);
+  ByteVector result(length / 2);
+  if (!result.empty()) {
+    HexDecode(&result[0], str, result.size());
   }
   return result;
 }
 
+static inline ByteVector HexToByteVector(std::string const &str) {
+  return HexToByteVector(str.data(), str.size());
+}
+
 static inline std::string HexToString(std::string const &str) {
-  std::string result;
   DS2ASSERT(str.size() % 2 == 0);
-  for (size_t n = 0; n < str.size(); n += 2) {
-    result += static_cast<char>(HexToByte(&str[n]));
+  std::string result(str.size() / 2, '\0');
+  if (!result.empty()) {
+    HexDecode(&result[0], str.data(), result.size());
   }
   return result;
 }
@@ -6,6 +6,7 @@
 
 #include "DebugServer2/Architecture/ARM/SoftwareSingleStep.h"
 #include "DebugServer2/Architecture/ARM/Branching.h"
+#include "DebugServer2/Core/SoftwareBreakpointManager.h"
 #include "DebugServer2/Utils/Bits.h"
 #include "DebugServer2/Utils/Log.h"
 
@@ -16,6 +17,17 @@ namespace ds2 {
 namespace Architecture {
 namespace ARM {
 
+//
+// Software breakpoints stay in memory while the inferior is stopped; decode
+// the instructions they replaced rather than the breakpoint opcodes.
+//
+static ErrorCode ReadInstructions(Process *process, uint32_t address,
+                                  void *buffer, size_t length) {
+  CHK(process->readMemory(address, buffer, length));
+  process->softwareBreakpointManager()->maskRead(address, buffer, length);
+  return kSuccess;
+}
+
 ErrorCode PrepareThumbSoftwareSingleStep(Process *process, uint32_t pc,
                                          CPUState const &state, bool &link,
                                          uint32_t &nextPC, uint32_t &nextPCSize,
@@ -23,7 +35,7 @@ ErrorCode PrepareThumbSoftwareSingleStep(Process *process, uint32_t pc,
                                          uint32_t &branchPCSize) {
   uint32_t insns[2];
 
-  CHK(process->readMemory(pc, insns, sizeof(insns)));
+  CHK(ReadInstructions(process, pc, insns, sizeof(insns)));
 
   ds2::Architecture::ARM::BranchInfo info;
   if (!ds2::Architecture::ARM::GetThumbBranchInfo(insns, info)) {
@@ -50,7 +62,7 @@ ErrorCode PrepareThumbSoftwareSingleStep(Process *process, uint32_t pc,
     //
     uint16_t itinsns[4 * 2]; // At most 4 instructions in the IT block.
 
-    CHK(process->readMemory(nextPC, itinsns, sizeof(itinsns)));
+    CHK(ReadInstructions(process, nextPC, itinsns, sizeof(itinsns)));
 
     size_t skip = 0;
     for (size_t n = 0; n < info.itCount; n++) {
@@ -192,7 +204,7 @@ ErrorCode PrepareARMSoftwareSingleStep(Process *process, uint32_t pc,
                                        uint32_t &branchPCSize) {
   uint32_t insn;
 
-  CHK(process->readMemory(pc, &insn, sizeof(insn)));
+  CHK(ReadInstructions(process, pc, &insn, sizeof(insn)));
 
   Architecture::ARM::BranchInfo info;
   if (!Architecture::ARM::GetARMBranchInfo(insn, info)) {
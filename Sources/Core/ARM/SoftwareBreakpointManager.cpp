@@ -31,7 +31,8 @@ ErrorCode SoftwareBreakpointManager::add(Address const &address,
       isThumb = true;
     } else {
       ds2::Architecture::CPUState state;
-      CHK(_process->currentThread()->readCPUState(state));
+      CHK(_process->currentThread()->readCPUStateSets(
+          state, ds2::Architecture::kRegisterSetGP));
       isThumb = state.isThumb();
     }
 
@@ -44,6 +45,7 @@ ErrorCode SoftwareBreakpointManager::add(Address const &address,
       //
       uint32_t insn;
       CHK(_process->readMemory(address.value() & ~1ULL, &insn, sizeof(insn)));
+      maskRead(address.value() & ~1ULL, &insn, sizeof(insn));
       auto inst_size = Architecture::ARM::GetThumbInstSize(insn);
       size = inst_size == Architecture::ARM::ThumbInstSize::TwoByteInst ? 2 : 3;
     } else {
@@ -82,14 +84,15 @@ void SoftwareBreakpointManager::enumerate(
 
 int SoftwareBreakpointManager::hit(Target::Thread *thread, Site &site) {
   ds2::Architecture::CPUState state;
-  thread->readCPUState(state);
+  thread->readCPUStateSets(state, ds2::Architecture::kRegisterSetGP);
 #if defined(OS_WIN32)
   state.setPC(state.pc() - 2);
   if (super::hit(state.pc(), site)) {
     //
     // Move the PC back to the instruction
     //
-    if (thread->writeCPUState(state) != kSuccess) {
+    if (thread->writeCPUStateSets(state, ds2::Architecture::kRegisterSetGP) !=
+        kSuccess) {
       abort();
     }
     return 0;
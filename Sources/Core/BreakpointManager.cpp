@@ -136,6 +136,11 @@ void BreakpointManager::disable(Target::Thread *thread) {
   //
   // Remove temporary breakpoints.
   //
+  removeExpiredSites();
+}
+
+void BreakpointManager::removeExpiredSites(
+    std::function<bool(Site const &)> const &cb) {
   auto it = _sites.begin();
   while (it != _sites.end()) {
     it->second.lifetime = it->second.lifetime & ~Lifetime::TemporaryOneShot;
@@ -143,7 +148,11 @@ void BreakpointManager::disable(Target::Thread *thread) {
       // refs should always be 0 unless we have a Lifetime::Permanent
       // breakpoint.
       DS2ASSERT(it->second.refs == 0);
-      _sites.erase(it++);
+      if (cb && !cb(it->second)) {
+        it++;
+        continue;
+      }
+      it = _sites.erase(it);
     } else {
       it++;
     }
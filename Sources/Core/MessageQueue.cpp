@@ -7,67 +7,200 @@
 #include "DebugServer2/Core/MessageQueue.h"
 #include "DebugServer2/Utils/Log.h"
 
+#include <algorithm>
 #include <chrono>
-
-// FIXME(strager): This class does not handle spurious
-// wakeups!  See http://en.wikipedia.org/wiki/Spurious_wakeup
+#if defined(OS_LINUX)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
 namespace ds2 {
 
-MessageQueue::MessageQueue() : _terminated(false) {}
+MessageQueue::MessageQueue()
+    : _head(0), _tail(0), _discard(0), _waiting(false), _terminated(false),
+      _overflowSize(0) {
+#if defined(OS_LINUX)
+  _event = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  DS2ASSERT(_event >= 0);
+#endif
+}
+
+MessageQueue::~MessageQueue() {
+#if defined(OS_LINUX)
+  ::close(_event);
+#endif
+}
 
 void MessageQueue::put(std::string const &message) {
-  std::lock_guard<std::mutex> guard(_lock);
-  _messages.push_back(message);
-  _ready.notify_one();
+  if (_terminated.load())
+    return;
+
+  size_t tail = _tail.load(std::memory_order_relaxed);
+
+  //
+  // The ring being full means the main thread is busy with something long.
+  // Everything the consumer takes from the overflow list is newer than what
+  // is in the ring, so we stick to the list until it is empty again.
+  //
+  if (_overflowSize.load() != 0 ||
+      tail - _head.load(std::memory_order_acquire) >= kCapacity) {
+    std::lock_guard<std::mutex> guard(_overflowLock);
+    _overflow.push_back(message);
+    _overflowSize.store(_overflow.size());
+  } else {
+    _messages[tail % kCapacity].assign(message);
+    _tail.store(tail + 1);
+  }
+
+  //
+  // Both this and the consumer's check use sequentially consistent
+  // operations: either we see it waiting, or it sees the new tail.
+  //
+  if (_waiting.load()) {
+    wake();
+  }
 }
 
 std::string MessageQueue::get(int wait) {
   std::string message;
+  get(message, wait);
+  return message;
+}
 
-  std::unique_lock<std::mutex> lock(_lock);
-  if (_messages.empty()) {
-    if (_terminated)
-      return std::string();
-
-    if (wait < 0) {
-      _ready.wait(lock);
-    } else {
-      if (_ready.wait_for(lock, std::chrono::milliseconds(wait)) ==
-          std::cv_status::timeout)
-        return std::string();
-    }
+bool MessageQueue::get(std::string &message, int wait) {
+  if (!this->wait(wait)) {
+    message.clear();
+    return false;
   }
-  if (!_messages.empty()) {
-    message = _messages.front();
-    _messages.pop_front();
+
+  size_t head = first();
+  if (head == _tail.load(std::memory_order_acquire)) {
+    _head.store(head, std::memory_order_release);
+    if (takeOverflow(message))
+      return true;
+    message.clear();
+    return false;
   }
 
-  return message;
+  message.swap(_messages[head % kCapacity]);
+  _head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+//
+// Index of the first message that hasn't been consumed nor discarded. The
+// indices wrap around, hence the comparison of distances.
+//
+size_t MessageQueue::first() const {
+  size_t head = _head.load(std::memory_order_relaxed);
+  size_t discard = _discard.load(std::memory_order_acquire);
+  size_t tail = _tail.load(std::memory_order_acquire);
+  return (discard - head <= tail - head) ? discard : head;
+}
+
+bool MessageQueue::empty() const {
+  return first() == _tail.load() && _overflowSize.load() == 0;
+}
+
+bool MessageQueue::takeOverflow(std::string &message) {
+  if (_overflowSize.load() == 0)
+    return false;
+
+  std::lock_guard<std::mutex> guard(_overflowLock);
+  if (_overflow.empty())
+    return false;
+
+  message.swap(_overflow.front());
+  _overflow.pop_front();
+  _overflowSize.store(_overflow.size());
+  return true;
 }
 
 bool MessageQueue::wait(int ms) {
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+
+  for (;;) {
+    if (!empty())
+      return true;
+    if (_terminated.load() || ms == 0)
+      return false;
+
+    _waiting.store(true);
+    bool ready = !empty() || _terminated.load();
+    if (!ready) {
+      int remaining = -1;
+      if (ms > 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        remaining = std::max(0, static_cast<int>(left.count()));
+      }
+      ready = sleep(remaining);
+    }
+    _waiting.store(false);
+
+    if (!ready && !empty())
+      return true;
+    if (!ready)
+      return false;
+  }
+}
+
+#if defined(OS_LINUX)
+bool MessageQueue::sleep(int ms) {
+  struct pollfd pfd;
+  pfd.fd = _event;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  int rc = ::poll(&pfd, 1, ms);
+  if (rc <= 0)
+    return rc < 0; // Interrupted: let the caller re-check.
+
+  uint64_t count;
+  ssize_t nread = ::read(_event, &count, sizeof(count));
+  (void)nread;
+  return true;
+}
+
+void MessageQueue::wake() {
+  uint64_t one = 1;
+  ssize_t nwritten = ::write(_event, &one, sizeof(one));
+  (void)nwritten;
+}
+#else
+bool MessageQueue::sleep(int ms) {
   std::unique_lock<std::mutex> lock(_lock);
-  if (!_messages.empty())
-    return true;
-  if (_terminated)
-    return false;
+  auto ready = [this]() { return !empty() || _terminated.load(); };
   if (ms < 0) {
-    _ready.wait(lock);
-    return !_messages.empty();
-  } else {
-    std::chrono::milliseconds duration(ms);
-    return _ready.wait_for(lock, duration) != std::cv_status::timeout;
+    _ready.wait(lock, ready);
+    return true;
   }
+  return _ready.wait_for(lock, std::chrono::milliseconds(ms), ready);
 }
 
-void MessageQueue::clear(bool terminating) {
+void MessageQueue::wake() {
   std::lock_guard<std::mutex> guard(_lock);
-  _messages.clear();
+  _ready.notify_one();
+}
+#endif
+
+void MessageQueue::clear(bool terminating) {
+  //
+  // Only the consumer may move the head, so we just mark everything queued
+  // so far as discarded; get() skips over it.
+  //
+  _discard.store(_tail.load());
+  {
+    std::lock_guard<std::mutex> guard(_overflowLock);
+    _overflow.clear();
+    _overflowSize.store(0);
+  }
   if (terminating) {
     DS2ASSERT(!_terminated);
-    _terminated = true;
-    _ready.notify_one();
+    _terminated.store(true);
+    wake();
   }
 }
 } // namespace ds2
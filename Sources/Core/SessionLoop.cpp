@@ -0,0 +1,68 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+#include "DebugServer2/Core/SessionLoop.h"
+
+using ds2::GDBRemote::Session;
+using ds2::Host::Channel;
+
+SessionLoop::SessionLoop(Channel *channel, Session *session)
+    : _channel(channel), _session(session) {
+  _pp.setDelegate(this);
+}
+
+void SessionLoop::run() {
+  while (_channel->connected()) {
+    if (_pending.empty()) {
+      if (!_channel->wait())
+        break;
+
+      pump();
+      continue;
+    }
+
+    //
+    // The command may resume the inferior, in which case pump() is called
+    // again before it returns; take the packet off the queue first.
+    //
+    std::string data = std::move(_pending.front());
+    _pending.pop_front();
+    _session->interpreter().onPacketData(data, true);
+  }
+}
+
+//
+// Reads whatever the channel has and parses it. Returns false once the
+// channel is closed.
+//
+bool SessionLoop::pump() {
+  std::string data;
+  if (_channel->receive(data)) {
+    _pp.parse(data);
+  }
+
+  return _channel->connected();
+}
+
+void SessionLoop::onPacketData(std::string const &data, bool valid) {
+  if (data.length() == 1 && data[0] == '\x03') {
+    //
+    // Interrupt process; as with SessionThread, the packets that came in
+    // before it are discarded. We are on the tracer thread here, so there
+    // is nothing to hand over.
+    //
+    _pending.clear();
+    _session->interpreter().onPacketData(data, valid);
+  } else if (_session->getAckMode() && !valid) {
+    _session->interpreter().onPacketData(data, valid);
+  } else {
+    _pending.push_back(data);
+  }
+}
+
+void SessionLoop::onInvalidData(std::string const &data) {
+  _session->interpreter().onInvalidData(data);
+}
@@ -5,12 +5,16 @@
 // source tree.
 
 #include "DebugServer2/Core/SoftwareBreakpointManager.h"
+#include "DebugServer2/Host/Platform.h"
 #include "DebugServer2/Target/Process.h"
 #include "DebugServer2/Target/Thread.h"
 #include "DebugServer2/Utils/HexValues.h"
 #include "DebugServer2/Utils/Log.h"
 
 #include <cstdlib>
+#include <cstring>
+
+using ds2::Host::Platform;
 
 #define super ds2::BreakpointManager
 
@@ -18,88 +22,302 @@ namespace ds2 {
 
 SoftwareBreakpointManager::SoftwareBreakpointManager(
     Target::ProcessBase *process)
-    : super(process), _enabled(false) {}
+    : super(process), _inserted(0), _enabled(false) {}
 
-SoftwareBreakpointManager::~SoftwareBreakpointManager() { clear(); }
+SoftwareBreakpointManager::~SoftwareBreakpointManager() {
+  // The process is going away, don't try to restore anything.
+  super::clear();
+  _inserted = 0;
+}
 
 void SoftwareBreakpointManager::clear() {
+  //
+  // Breakpoints stay inserted while the inferior is stopped; put the original
+  // instructions back before forgetting about them.
+  //
+  if (_enabled) {
+    disable();
+  }
+
   super::clear();
-  _insns.clear();
+  _inserted = 0;
 }
 
 ErrorCode SoftwareBreakpointManager::enableLocation(Site const &site,
                                                     Target::Thread *thread) {
-  ByteVector opcode;
-  ByteVector old;
-  ErrorCode error;
-
   if (thread != nullptr) {
     DS2LOG(Warning, "thread-specific software breakpoints are unsupported");
   }
 
-  getOpcode(site.size, opcode);
-  old.resize(opcode.size());
-  error = _process->readMemory(site.address, old.data(), old.size());
-  if (error != kSuccess) {
-    DS2LOG(Error, "cannot enable breakpoint at %" PRI_PTR ", readMemory failed",
-           PRI_PTR_CAST(site.address.value()));
-    return error;
+  if (!site.insn.empty()) {
+    return kSuccess;
   }
 
-  error = _process->writeMemory(site.address, opcode.data(), opcode.size());
-  if (error != kSuccess) {
-    DS2LOG(Error,
-           "cannot enable breakpoint at %" PRI_PTR ", writeMemory failed",
-           PRI_PTR_CAST(site.address.value()));
-    return error;
+  return patchSites(std::vector<uint64_t>(1, site.address), true);
+}
+
+ErrorCode SoftwareBreakpointManager::disableLocation(Site const &site,
+                                                     Target::Thread *thread) {
+  if (thread != nullptr) {
+    DS2LOG(Warning, "thread-specific software breakpoints are unsupported");
+  }
+
+  if (site.insn.empty()) {
+    return kSuccess;
   }
 
-  DS2LOG(Debug,
-         "set breakpoint instruction 0x%s at %" PRI_PTR " (saved insn 0x%s)",
-         ToHex(opcode).c_str(), PRI_PTR_CAST(site.address.value()),
-         ToHex(old).c_str());
+  return patchSites(std::vector<uint64_t>(1, site.address), false);
+}
 
-  _insns[site.address] = old;
+ErrorCode
+SoftwareBreakpointManager::patchSites(std::vector<uint64_t> const &addresses,
+                                      bool insert) {
+  uint64_t pageMask = ~static_cast<uint64_t>(Platform::GetPageSize() - 1);
+  ErrorCode result = kSuccess;
 
-  return kSuccess;
+  auto first = addresses.begin();
+  while (first != addresses.end()) {
+    auto last = first;
+    while (last != addresses.end() && (*last & pageMask) == (*first & pageMask))
+      ++last;
+
+    ErrorCode error = patchPage(first, last, insert);
+    if (error != kSuccess) {
+      result = error;
+    }
+
+    first = last;
+  }
+
+  return result;
 }
 
-ErrorCode SoftwareBreakpointManager::disableLocation(Site const &site,
-                                                     Target::Thread *thread) {
-  ErrorCode error;
-  ByteVector old = _insns[site.address];
+ErrorCode SoftwareBreakpointManager::patchPage(
+    std::vector<uint64_t>::const_iterator first,
+    std::vector<uint64_t>::const_iterator last, bool insert) {
+  ByteVector opcode;
 
-  if (thread != nullptr) {
-    DS2LOG(Warning, "thread-specific software breakpoints are unsupported");
+  //
+  // Read everything the sites cover at once.
+  //
+  uint64_t start = *first;
+  uint64_t end = start;
+  for (auto it = first; it != last; ++it) {
+    getOpcode(_sites.find(*it)->second.size, opcode);
+    end = std::max<uint64_t>(end, *it + opcode.size());
+  }
+
+  ByteVector data(end - start);
+  ErrorCode error = _process->readMemory(start, data.data(), data.size());
+  if (error != kSuccess) {
+    DS2LOG(Error, "cannot %s breakpoints at %" PRI_PTR ", readMemory failed",
+           insert ? "enable" : "disable", PRI_PTR_CAST(start));
+    return error;
+  }
+
+  _process->invalidateMemoryCache(start, end - start);
+
+  //
+  // Patch every site in the buffer and write the whole range back at once;
+  // the bytes between sites are written back as they were read.
+  //
+  std::vector<ByteVector> saved;
+  for (auto it = first; it != last; ++it) {
+    Site const &site = _sites.find(*it)->second;
+    uint8_t *bytes = &data[*it - start];
+
+    if (insert) {
+      getOpcode(site.size, opcode);
+      ByteVector old(bytes, bytes + opcode.size());
+      maskRead(*it, old.data(), old.size());
+      std::memcpy(bytes, opcode.data(), opcode.size());
+      saved.push_back(old);
+    } else {
+      std::memcpy(bytes, site.insn.data(), site.insn.size());
+    }
   }
 
-  error = _process->writeMemory(site.address, old.data(), old.size());
+  error = _process->writeMemory(start, data.data(), data.size());
   if (error != kSuccess) {
-    DS2LOG(Error, "cannot restore instruction at %" PRI_PTR,
-           PRI_PTR_CAST(site.address.value()));
+    DS2LOG(Error, "cannot %s breakpoints at %" PRI_PTR ", writeMemory failed",
+           insert ? "enable" : "disable", PRI_PTR_CAST(start));
     return error;
   }
 
-  DS2LOG(Debug, "reset instruction 0x%s at %" PRI_PTR, ToHex(old).c_str(),
-         PRI_PTR_CAST(site.address.value()));
+  for (auto it = first; it != last; ++it) {
+    Site &site = _sites.find(*it)->second;
 
-  _insns.erase(site.address);
+    if (insert) {
+      site.insn = saved[it - first];
+      _inserted++;
+      DS2LOG(Debug, "set breakpoint at %" PRI_PTR " (saved insn 0x%s)",
+             PRI_PTR_CAST(site.address.value()), ToHex(site.insn).c_str());
+    } else {
+      DS2LOG(Debug, "reset instruction 0x%s at %" PRI_PTR,
+             ToHex(site.insn).c_str(), PRI_PTR_CAST(site.address.value()));
+      site.insn.clear();
+      _inserted--;
+    }
+  }
 
   return kSuccess;
 }
 
 void SoftwareBreakpointManager::enable(Target::Thread *thread) {
-  super::enable(thread);
+  //
+  // Breakpoints that are already in memory are left alone, so this only
+  // costs anything for the ones added or stepped over since the last resume.
+  //
+  if (_inserted != _sites.size()) {
+    std::vector<uint64_t> addresses;
+    for (auto const &it : _sites) {
+      if (it.second.insn.empty()) {
+        addresses.push_back(it.first);
+      }
+    }
+    patchSites(addresses, true);
+  }
 
   _enabled = true;
 }
 
 void SoftwareBreakpointManager::disable(Target::Thread *thread) {
-  super::disable(thread);
+  if (!enabled(thread)) {
+    DS2LOG(Warning, "double-disabling breakpoints");
+  }
+
+  std::vector<uint64_t> addresses;
+  for (auto const &it : _sites) {
+    if (!it.second.insn.empty()) {
+      addresses.push_back(it.first);
+    }
+  }
+  patchSites(addresses, false);
 
+  removeExpired();
   _enabled = false;
 }
 
+void SoftwareBreakpointManager::removeExpired() {
+  std::vector<uint64_t> addresses;
+  for (auto const &it : _sites) {
+    if ((it.second.lifetime & ~Lifetime::TemporaryOneShot) == Lifetime::None &&
+        !it.second.insn.empty()) {
+      addresses.push_back(it.first);
+    }
+  }
+  patchSites(addresses, false);
+
+  //
+  // A site whose original instruction we failed to restore still has its
+  // breakpoint in memory. Keep it, so that maskRead() still hides the opcode
+  // and a hit is still recognized, and try again on the next stop.
+  //
+  removeExpiredSites([](Site const &site) {
+    if (!site.insn.empty()) {
+      DS2LOG(Warning, "breakpoint at %" PRI_PTR " is still inserted",
+             PRI_PTR_CAST(site.address.value()));
+      return false;
+    }
+    return true;
+  });
+}
+
+ErrorCode SoftwareBreakpointManager::stepAddress(Target::Thread *thread,
+                                                 Address const &address,
+                                                 Address &pc) const {
+  pc = address;
+  if (!pc.valid()) {
+    Architecture::CPUState state;
+    CHK(thread->readCPUStateSets(state, Architecture::kRegisterSetGP));
+    pc = state.pc();
+  }
+
+  return kSuccess;
+}
+
+ErrorCode SoftwareBreakpointManager::prepareStep(Target::Thread *thread,
+                                                 Address const &address) {
+  Address pc;
+  CHK(stepAddress(thread, address, pc));
+
+  //
+  // Stepping from an inserted breakpoint would execute the breakpoint
+  // instruction instead of the original one.
+  //
+  auto it = _sites.find(pc);
+  if (it == _sites.end()) {
+    return kSuccess;
+  }
+
+  return disableLocation(it->second);
+}
+
+bool SoftwareBreakpointManager::stepsFromSite(Target::Thread *thread,
+                                              Address const &address) const {
+  Address pc;
+  if (stepAddress(thread, address, pc) != kSuccess) {
+    return false;
+  }
+
+  return _sites.find(pc) != _sites.end();
+}
+
+void SoftwareBreakpointManager::maskRead(Address const &address, void *buffer,
+                                         size_t length) const {
+  if (_inserted == 0 || length == 0) {
+    return;
+  }
+
+  uint64_t start = address.value();
+  uint64_t end = start + length;
+  auto bytes = static_cast<uint8_t *>(buffer);
+
+  // Breakpoint opcodes are at most 4 bytes long, so the first one that can
+  // overlap the buffer starts at most 3 bytes before it.
+  auto it = _sites.lower_bound(start > 3 ? start - 3 : 0);
+  for (; it != _sites.end() && it->first < end; ++it) {
+    ByteVector const &insn = it->second.insn;
+    for (size_t n = 0; n < insn.size(); n++) {
+      uint64_t byteAddress = it->first + n;
+      if (byteAddress >= start && byteAddress < end) {
+        bytes[byteAddress - start] = insn[n];
+      }
+    }
+  }
+}
+
+void SoftwareBreakpointManager::maskWrite(Address const &address, void *buffer,
+                                          size_t length) {
+  if (_inserted == 0 || length == 0) {
+    return;
+  }
+
+  uint64_t start = address.value();
+  uint64_t end = start + length;
+  auto bytes = static_cast<uint8_t *>(buffer);
+
+  auto it = _sites.lower_bound(start > 3 ? start - 3 : 0);
+  for (; it != _sites.end() && it->first < end; ++it) {
+    ByteVector &insn = it->second.insn;
+    if (insn.empty()) {
+      continue;
+    }
+
+    ByteVector opcode;
+    getOpcode(it->second.size, opcode);
+    DS2ASSERT(opcode.size() == insn.size());
+
+    for (size_t n = 0; n < insn.size(); n++) {
+      uint64_t byteAddress = it->first + n;
+      if (byteAddress >= start && byteAddress < end) {
+        insn[n] = bytes[byteAddress - start];
+        bytes[byteAddress - start] = opcode[n];
+      }
+    }
+  }
+}
+
 bool SoftwareBreakpointManager::enabled(Target::Thread *thread) const {
   if (thread != nullptr) {
     DS2LOG(Warning, "thread-specific software breakpoints are unsupported");
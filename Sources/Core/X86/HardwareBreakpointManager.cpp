@@ -241,7 +241,7 @@ ErrorCode HardwareBreakpointManager::readDebugRegisters(
     Target::Thread *thread, std::vector<uint64_t> &regs) const {
   Architecture::CPUState state;
 
-  CHK(thread->readCPUState(state));
+  CHK(thread->readCPUStateSets(state, Architecture::kRegisterSetDebug));
 
 #if defined(ARCH_X86)
   for (int i = 0; i < kNumDebugRegisters; ++i) {
@@ -266,7 +266,7 @@ ErrorCode HardwareBreakpointManager::writeDebugRegisters(
     Target::Thread *thread, std::vector<uint64_t> &regs) const {
   Architecture::CPUState state;
 
-  CHK(thread->readCPUState(state));
+  CHK(thread->readCPUStateSets(state, Architecture::kRegisterSetDebug));
 
 #if defined(ARCH_X86)
   for (int i = 0; i < kNumDebugRegisters; ++i) {
@@ -284,6 +284,6 @@ ErrorCode HardwareBreakpointManager::writeDebugRegisters(
 #error "Architecture not supported."
 #endif
 
-  return thread->writeCPUState(state);
+  return thread->writeCPUStateSets(state, Architecture::kRegisterSetDebug);
 }
 } // namespace ds2
@@ -23,7 +23,15 @@ int SoftwareBreakpointManager::hit(Target::Thread *thread, Site &site) {
   if (thread->state() == Target::Thread::kStepped)
     return 0;
 
-  thread->readCPUState(state);
+  //
+  // Breakpoints stay inserted while stepping; a thread that just stepped
+  // over a one-byte instruction at a breakpoint address would otherwise look
+  // like it hit it.
+  //
+  if (thread->stopInfo().reason == StopInfo::kReasonTrace)
+    return -1;
+
+  thread->readCPUStateSets(state, ds2::Architecture::kRegisterSetGP);
   state.setPC(state.pc() - 1);
 
   if (super::hit(state.pc(), site)) {
@@ -31,11 +39,12 @@ int SoftwareBreakpointManager::hit(Target::Thread *thread, Site &site) {
     // Move the PC back to the instruction, INT3 will move
     // the instruction pointer to the next byte.
     //
-    if (thread->writeCPUState(state) != kSuccess)
+    if (thread->writeCPUStateSets(state, ds2::Architecture::kRegisterSetGP) !=
+        kSuccess)
       abort();
 
     uint64_t ex = state.pc();
-    thread->readCPUState(state);
+    thread->readCPUStateSets(state, ds2::Architecture::kRegisterSetGP);
     DS2ASSERT(ex == state.pc());
 
     return 0;
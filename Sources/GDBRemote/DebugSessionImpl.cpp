@@ -9,12 +9,16 @@
 #include "DebugServer2/Core/SoftwareBreakpointManager.h"
 #include "DebugServer2/GDBRemote/Session.h"
 #include "DebugServer2/Host/Platform.h"
+#include "DebugServer2/Utils/CRC32.h"
 #include "DebugServer2/Utils/HexValues.h"
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/Paths.h"
 #include "DebugServer2/Utils/Stringify.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
+#include <limits>
 #include <sstream>
 
 using ds2::Host::Platform;
@@ -26,28 +30,35 @@ namespace GDBRemote {
 
 DebugSessionImplBase::DebugSessionImplBase(StringCollection const &args,
                                            EnvironmentBlock const &env)
-    : DummySessionDelegateImpl(), _resumeSession(nullptr) {
+    : DummySessionDelegateImpl(), _resumeSession(nullptr), _watchedFd(-1) {
   DS2ASSERT(args.size() >= 1);
-  _resumeSessionLock.lock();
   spawnProcess(args, env);
 }
 
 DebugSessionImplBase::DebugSessionImplBase(int attachPid)
-    : DummySessionDelegateImpl(), _resumeSession(nullptr) {
-  _resumeSessionLock.lock();
+    : DummySessionDelegateImpl(), _resumeSession(nullptr), _watchedFd(-1) {
   _process = ds2::Target::Process::Attach(attachPid);
   if (_process == nullptr)
     DS2LOG(Fatal, "cannot attach to pid %d", attachPid);
 }
 
 DebugSessionImplBase::DebugSessionImplBase()
-    : DummySessionDelegateImpl(), _process(nullptr), _resumeSession(nullptr) {
-  _resumeSessionLock.lock();
-}
+    : DummySessionDelegateImpl(), _process(nullptr), _resumeSession(nullptr),
+      _watchedFd(-1) {}
+
+DebugSessionImplBase::~DebugSessionImplBase() { delete _process; }
+
+//
+// The descriptor is also handed to any process we attach to or spawn later.
+//
+void DebugSessionImplBase::watchDescriptor(
+    int fd, std::function<bool()> const &handler) {
+  _watchedFd = fd;
+  _watchedHandler = handler;
 
-DebugSessionImplBase::~DebugSessionImplBase() {
-  _resumeSessionLock.unlock();
-  delete _process;
+  if (_process != nullptr) {
+    _process->watchDescriptor(fd, handler);
+  }
 }
 
 size_t DebugSessionImplBase::getGPRSize() const {
@@ -72,21 +83,33 @@ ErrorCode DebugSessionImplBase::onQuerySupported(
     DS2LOG(Debug, "gdb feature: %s", feature.name.c_str());
   }
 
-  // TODO PacketSize should be respected
+  //
+  // Packets of any size are parsed incrementally, so the limit is only here
+  // to keep the debugger from building unreasonably large requests; it is
+  // sized for big memory transfers.
+  //
+  std::ostringstream packetSize;
+  packetSize << "PacketSize=" << std::hex << kMaxPacketSize;
+
   localFeatures.push_back(std::string("qEcho+"));
-  localFeatures.push_back(std::string("PacketSize=3fff"));
+  localFeatures.push_back(packetSize.str());
   localFeatures.push_back(std::string("QStartNoAckMode+"));
   localFeatures.push_back(std::string("qXfer:features:read+"));
 #if defined(OS_LINUX) || defined(OS_FREEBSD)
   localFeatures.push_back(std::string("qXfer:auxv:read+"));
   localFeatures.push_back(std::string("qXfer:libraries-svr4:read+"));
+#if defined(OS_LINUX)
+  localFeatures.push_back(std::string("qXfer:memory-regions:read+"));
+#endif
 #elif defined(OS_WIN32)
   localFeatures.push_back(std::string("qXfer:libraries:read+"));
 #endif
   localFeatures.push_back(std::string("QListThreadsInStopReply+"));
   localFeatures.push_back(std::string("QPassSignals+"));
 
-  if (session.mode() != kCompatibilityModeLLDB) {
+  if (session.mode() == kCompatibilityModeLLDB) {
+    localFeatures.push_back(std::string("MultiMemRead+"));
+  } else {
     localFeatures.push_back(std::string("ConditionalBreakpoints-"));
     localFeatures.push_back(std::string("BreakpointCommands+"));
     localFeatures.push_back(std::string("multiprocess+"));
@@ -168,7 +191,8 @@ Thread *DebugSessionImplBase::findThread(ProcessThreadId const &ptid) const {
 }
 
 ErrorCode DebugSessionImplBase::queryStopInfo(Session &session, Thread *thread,
-                                              StopInfo &stop) const {
+                                              StopInfo &stop,
+                                              bool listThreads) const {
   DS2ASSERT(thread != nullptr);
 
   // Directly copy the fields that are common between ds2::StopInfo and
@@ -193,7 +217,7 @@ ErrorCode DebugSessionImplBase::queryStopInfo(Session &session, Thread *thread,
     stop.threadName = Platform::GetThreadName(stop.ptid.pid, stop.ptid.tid);
 
     Architecture::CPUState state;
-    CHK(thread->readCPUState(state));
+    CHK(thread->readCPUStateSets(state, Architecture::kRegisterSetGP));
     state.getStopGPState(stop.registers,
                          session.mode() == kCompatibilityModeLLDB);
   } break;
@@ -207,8 +231,10 @@ ErrorCode DebugSessionImplBase::queryStopInfo(Session &session, Thread *thread,
     DS2BUG("impossible StopInfo event: %s", Stringify::StopEvent(stop.event));
   }
 
-  _process->enumerateThreads(
-      [&](Thread *thread) { stop.threads.insert(thread->tid()); });
+  if (listThreads) {
+    _process->enumerateThreads(
+        [&](Thread *thread) { stop.threads.insert(thread->tid()); });
+  }
 
   return kSuccess;
 }
@@ -528,9 +554,12 @@ ErrorCode DebugSessionImplBase::onXferRead(Session &session,
     _process->enumerateThreads([&](Thread *thread) {
       ss << "<thread "
          << "id=\"p" << std::hex << _process->pid() << '.' << std::hex
-         << thread->tid() << "\" "
-         << "core=\"" << std::dec << thread->core() << "\""
-         << "/>" << std::endl;
+         << thread->tid() << "\"";
+      // The core is unknown until the thread stopped at least once.
+      if (thread->core() != static_cast<uint32_t>(-1)) {
+        ss << " core=\"" << std::dec << thread->core() << "\"";
+      }
+      ss << "/>" << std::endl;
     });
 
     ss << "</threads>" << std::endl;
@@ -586,6 +615,15 @@ ErrorCode DebugSessionImplBase::onXferRead(Session &session,
     ss << sslibs.str();
     ss << "</library-list-svr4>";
     buffer = ss.str().substr(offset);
+  } else if (object == "memory-regions") {
+    if (offset == 0 || _memoryRegionsBuffer.empty()) {
+      CHK(generateMemoryRegionsJson(_memoryRegionsBuffer));
+    }
+
+    if (offset < _memoryRegionsBuffer.size()) {
+      buffer = _memoryRegionsBuffer.substr(offset, length);
+    }
+    last = offset + buffer.size() >= _memoryRegionsBuffer.size();
   } else {
     return kErrorUnsupported;
   }
@@ -637,7 +675,7 @@ ErrorCode DebugSessionImplBase::onReadGeneralRegisters(
     return kErrorProcessNotFound;
 
   Architecture::CPUState state;
-  CHK(thread->readCPUState(state));
+  CHK(thread->readCPUStateSets(state, Architecture::kRegisterSetGP));
 
   state.getGPState(regs);
 
@@ -651,11 +689,11 @@ ErrorCode DebugSessionImplBase::onWriteGeneralRegisters(
     return kErrorProcessNotFound;
 
   Architecture::CPUState state;
-  CHK(thread->readCPUState(state));
+  CHK(thread->readCPUStateSets(state, Architecture::kRegisterSetGP));
 
   state.setGPState(regs);
 
-  return thread->writeCPUState(state);
+  return thread->writeCPUStateSets(state, Architecture::kRegisterSetGP);
 }
 
 ErrorCode DebugSessionImplBase::onSaveRegisters(Session &session,
@@ -701,8 +739,12 @@ ErrorCode DebugSessionImplBase::onReadRegisterValue(Session &session,
   if (thread == nullptr)
     return kErrorProcessNotFound;
 
+  //
+  // Most single register accesses are for GPRs; only fetch the other
+  // register sets when the register lives in one of them.
+  //
   Architecture::CPUState state;
-  CHK(thread->readCPUState(state));
+  CHK(thread->readCPUStateSets(state, Architecture::kRegisterSetGP));
 
   void *ptr;
   size_t length;
@@ -717,6 +759,11 @@ ErrorCode DebugSessionImplBase::onReadRegisterValue(Session &session,
   if (!success)
     return kErrorInvalidArgument;
 
+  Architecture::RegisterSet set = state.getRegisterSet(ptr);
+  if (!(state.populatedSets & set)) {
+    CHK(thread->readCPUStateSets(state, set));
+  }
+
   value.insert(value.end(), reinterpret_cast<char *>(ptr),
                reinterpret_cast<char *>(ptr) + length);
 
@@ -730,8 +777,12 @@ ErrorCode DebugSessionImplBase::onWriteRegisterValue(
   if (thread == nullptr)
     return kErrorProcessNotFound;
 
+  //
+  // Most single register accesses are for GPRs; only fetch the other
+  // register sets when the register lives in one of them.
+  //
   Architecture::CPUState state;
-  CHK(thread->readCPUState(state));
+  CHK(thread->readCPUStateSets(state, Architecture::kRegisterSetGP));
 
   void *ptr;
   size_t length;
@@ -746,12 +797,17 @@ ErrorCode DebugSessionImplBase::onWriteRegisterValue(
   if (!success)
     return kErrorInvalidArgument;
 
+  Architecture::RegisterSet set = state.getRegisterSet(ptr);
+  if (!(state.populatedSets & set)) {
+    CHK(thread->readCPUStateSets(state, set));
+  }
+
   if (value.length() != length)
     return kErrorInvalidArgument;
 
   std::memcpy(ptr, value.c_str(), length);
 
-  return thread->writeCPUState(state);
+  return thread->writeCPUStateSets(state, set);
 }
 
 ErrorCode DebugSessionImplBase::onReadMemory(Session &, Address const &address,
@@ -771,6 +827,16 @@ ErrorCode DebugSessionImplBase::onWriteMemory(Session &, Address const &address,
     return _process->writeMemoryBuffer(address, data, &nwritten);
 }
 
+ErrorCode
+DebugSessionImplBase::onReadMemoryVector(Session &,
+                                         MemoryRange::Collection const &ranges,
+                                         std::vector<ByteVector> &data) {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+  else
+    return _process->readMemoryBuffers(ranges, data);
+}
+
 ErrorCode DebugSessionImplBase::onAllocateMemory(Session &, size_t size,
                                                  uint32_t permissions,
                                                  Address &address) {
@@ -804,6 +870,251 @@ DebugSessionImplBase::onQueryMemoryRegionInfo(Session &, Address const &address,
     return _process->getMemoryRegionInfo(address, info);
 }
 
+//
+// Memory searches and checksums read the target in chunks of this size.
+//
+static size_t const kMemoryChunkSize = 1024 * 1024;
+
+static JSString *HexJSString(uint64_t value) {
+  std::ostringstream ss;
+  ss << "0x" << std::hex << value;
+  return JSString::New(ss.str());
+}
+
+//
+// A JSON array with one object per mapped region. Addresses, sizes and file
+// offsets are hex strings since they do not always fit in a signed 64-bit
+// JSON integer (e.g.: [vsyscall] on x86_64).
+//
+ErrorCode DebugSessionImplBase::generateMemoryRegionsJson(std::string &json) {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  JSArray regions;
+  auto appendRegion = [&regions](ds2::MemoryRegionInfo const &info) {
+    std::string permissions;
+    if (info.protection & kProtectionRead)
+      permissions += 'r';
+    if (info.protection & kProtectionWrite)
+      permissions += 'w';
+    if (info.protection & kProtectionExecute)
+      permissions += 'x';
+
+    auto region = JSDictionary::New();
+    region->set("start", HexJSString(info.start));
+    region->set("size", HexJSString(info.length));
+    region->set("permissions", JSString::New(permissions));
+    if (!info.name.empty()) {
+      region->set("name", JSString::New(info.name));
+    }
+#if defined(OS_LINUX)
+    if (!info.backingFile.empty()) {
+      region->set("file", JSString::New(info.backingFile));
+      region->set("file_offset", HexJSString(info.backingFileOffset));
+      region->set("inode", JSInteger::New(info.backingFileInode));
+    }
+#endif
+    regions.append(region);
+  };
+
+  CHK(_process->enumerateMemoryRegions(appendRegion));
+
+  json = regions.toString();
+  return kSuccess;
+}
+
+ErrorCode DebugSessionImplBase::onComputeCRC(Session &, Address const &address,
+                                             size_t length, uint32_t &crc) {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  crc = 0xffffffff;
+
+  uint64_t current = address;
+  while (length > 0) {
+    size_t chunkSize = std::min(length, kMemoryChunkSize);
+
+    ByteVector chunk;
+    CHK(_process->readMemoryBuffer(current, chunkSize, chunk));
+    if (chunk.size() != chunkSize)
+      return kErrorInvalidAddress;
+
+    crc = Utils::CRC32(crc, chunk.data(), chunk.size());
+    current += chunkSize;
+    length -= chunkSize;
+  }
+
+  return kSuccess;
+}
+
+static uint8_t const *FindPattern(uint8_t const *data, size_t size,
+                                  std::string const &pattern) {
+#if defined(OS_POSIX)
+  // The libc implementations we run on have vectorized memmem().
+  return static_cast<uint8_t const *>(
+      ::memmem(data, size, pattern.data(), pattern.size()));
+#else
+  auto first = reinterpret_cast<uint8_t const *>(pattern.data());
+  auto it = std::search(data, data + size, first, first + pattern.size());
+  return it == data + size ? nullptr : it;
+#endif
+}
+
+//
+// Memory searches skip the parts of the address space that are not mapped
+// readable. Returns the bounds of the region containing `address`, the end
+// clamped to `limit`, and whether it can be read. When the target cannot
+// describe its memory map, the whole range is assumed readable and unreadable
+// chunks are skipped as we go.
+//
+static bool GetSearchRegion(Target::Process *process, uint64_t address,
+                            uint64_t limit, uint64_t &start, uint64_t &end) {
+  MemoryRegionInfo info;
+  if (process->getMemoryRegionInfo(address, info) != kSuccess ||
+      info.length == 0) {
+    start = 0;
+    end = limit;
+    return true;
+  }
+
+  start = info.start;
+  end = info.start + info.length;
+  if (end < start || end > limit) {
+    end = limit;
+  }
+  return (info.protection & kProtectionRead) != 0;
+}
+
+ErrorCode DebugSessionImplBase::onSearch(Session &, Address const &address,
+                                         size_t length,
+                                         std::string const &pattern,
+                                         Address &location) {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+  else if (pattern.empty())
+    return kErrorInvalidArgument;
+
+  uint64_t current = address;
+  uint64_t end = current + length;
+  if (end < current) {
+    end = std::numeric_limits<uint64_t>::max();
+  }
+
+  //
+  // `window` holds the bytes of the current chunk, preceded by the last
+  // pattern.size() - 1 bytes of the previous one when they are contiguous, so
+  // that matches that straddle two chunks are found.
+  //
+  ByteVector window;
+  uint64_t windowStart = current;
+
+  while (current < end) {
+    uint64_t regionStart, regionEnd;
+    if (!GetSearchRegion(_process, current, end, regionStart, regionEnd)) {
+      window.clear();
+      current = regionEnd;
+      continue;
+    }
+
+    uint64_t chunkEnd = regionEnd;
+    if (chunkEnd - current > kMemoryChunkSize) {
+      chunkEnd = current + kMemoryChunkSize;
+    }
+
+    ByteVector chunk;
+    if (_process->readMemoryBuffer(current, chunkEnd - current, chunk) !=
+            kSuccess ||
+        chunk.empty()) {
+      window.clear();
+      current = chunkEnd;
+      continue;
+    }
+
+    if (window.empty()) {
+      windowStart = current;
+    }
+    window.insert(window.end(), chunk.begin(), chunk.end());
+
+    uint8_t const *match = FindPattern(window.data(), window.size(), pattern);
+    if (match != nullptr) {
+      location = windowStart + (match - window.data());
+      return kSuccess;
+    }
+
+    current += chunk.size();
+
+    size_t keep = std::min(window.size(), pattern.size() - 1);
+    window.erase(window.begin(), window.end() - keep);
+    windowStart = current - keep;
+  }
+
+  return kErrorNotFound;
+}
+
+ErrorCode DebugSessionImplBase::onSearchBackward(Session &,
+                                                 Address const &address,
+                                                 uint32_t pattern,
+                                                 uint32_t mask,
+                                                 Address &location) {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  //
+  // Candidates are the words starting at `address`, `address - 1`, and so on.
+  // `window` holds the chunk being scanned followed by the first
+  // sizeof(pattern) - 1 bytes of the chunk above it when they are contiguous.
+  //
+  uint64_t top = address.value() + sizeof(pattern);
+  if (top < address.value()) {
+    top = std::numeric_limits<uint64_t>::max();
+  }
+
+  ByteVector window;
+
+  while (top > 0) {
+    uint64_t regionStart, regionEnd;
+    if (!GetSearchRegion(_process, top - 1, top, regionStart, regionEnd)) {
+      window.clear();
+      top = regionStart;
+      continue;
+    }
+
+    uint64_t bottom = regionStart;
+    if (top - bottom > kMemoryChunkSize) {
+      bottom = top - kMemoryChunkSize;
+    }
+
+    ByteVector chunk;
+    if (_process->readMemoryBuffer(bottom, top - bottom, chunk) != kSuccess ||
+        chunk.size() != top - bottom) {
+      window.clear();
+      top = bottom;
+      continue;
+    }
+
+    chunk.insert(chunk.end(), window.begin(), window.end());
+    window.swap(chunk);
+
+    for (size_t n = window.size(); n >= sizeof(pattern); n--) {
+      uint64_t candidate = bottom + n - sizeof(pattern);
+      if (candidate > address.value())
+        continue;
+
+      uint32_t word;
+      std::memcpy(&word, &window[n - sizeof(pattern)], sizeof(word));
+      if ((word & mask) == (pattern & mask)) {
+        location = candidate;
+        return kSuccess;
+      }
+    }
+
+    window.resize(std::min<size_t>(window.size(), sizeof(pattern) - 1));
+    top = bottom;
+  }
+
+  return kErrorNotFound;
+}
+
 ErrorCode
 DebugSessionImplBase::onSetProgramArguments(Session &,
                                             StringCollection const &args) {
@@ -832,22 +1143,43 @@ ErrorCode DebugSessionImplBase::onAttach(Session &session, ProcessId pid,
   if (_process == nullptr) {
     return kErrorProcessNotFound;
   }
+  if (_watchedFd >= 0) {
+    _process->watchDescriptor(_watchedFd, _watchedHandler);
+  }
 
   return queryStopInfo(session, pid, stop);
 }
 
 ErrorCode
 DebugSessionImplBase::onResume(Session &session,
-                               ThreadResumeAction::Collection const &actions,
+                               ThreadResumeAction::Collection const &requested,
                                StopInfo &stop) {
   ErrorCode error;
   ThreadResumeAction globalAction;
   bool hasGlobalAction = false;
   std::set<Thread *> excluded;
 
-  DS2ASSERT(_resumeSession == nullptr);
-  _resumeSession = &session;
-  _resumeSessionLock.unlock();
+  //
+  // A thread stepping from a breakpoint has it lifted for the step (see
+  // prepareStep()), and any other thread we let run could go through that
+  // address without trapping. Such a thread steps alone: its step is then the
+  // first stop of this resume, and once it is reported the other threads
+  // would be stopped anyway.
+  //
+  ThreadResumeAction::Collection loneStep;
+  findLoneStep(requested, loneStep);
+  ThreadResumeAction::Collection const &actions =
+      loneStep.empty() ? requested : loneStep;
+
+  {
+    std::lock_guard<std::mutex> guard(_resumeSessionLock);
+    DS2ASSERT(_resumeSession == nullptr);
+    _resumeSession = &session;
+    flushOutput();
+  }
+
+  // The mappings may change once the process runs.
+  _memoryRegionsBuffer.clear();
 
   error = _process->beforeResume();
   if (error != kSuccess)
@@ -890,7 +1222,10 @@ DebugSessionImplBase::onResume(Session &session,
       excluded.insert(thread);
     } else if (action.action == kResumeActionSingleStep ||
                action.action == kResumeActionSingleStepWithSignal) {
-      error = thread->step(action.signal, action.address);
+      error = prepareStep(thread, action.address);
+      if (error == kSuccess) {
+        error = thread->step(action.signal, action.address);
+      }
       if (error != kSuccess) {
         DS2LOG(Warning, "cannot step pid %" PRIu64 " tid %" PRIu64 ", error=%s",
                (uint64_t)_process->pid(), (uint64_t)thread->tid(),
@@ -926,7 +1261,10 @@ DebugSessionImplBase::onResume(Session &session,
                globalAction.action == kResumeActionSingleStepWithSignal) {
       Thread *thread = _process->currentThread();
       if (excluded.find(thread) == excluded.end()) {
-        error = thread->step(globalAction.signal, globalAction.address);
+        error = prepareStep(thread, globalAction.address);
+        if (error == kSuccess) {
+          error = thread->step(globalAction.signal, globalAction.address);
+        }
         if (error != kSuccess) {
           DS2LOG(Warning,
                  "cannot step pid %" PRIu64 " tid %" PRIu64 ", error=%s",
@@ -993,11 +1331,64 @@ DebugSessionImplBase::onResume(Session &session,
   }
 
 ret:
-  _resumeSessionLock.lock();
+  std::lock_guard<std::mutex> guard(_resumeSessionLock);
   _resumeSession = nullptr;
   return error;
 }
 
+//
+// Looks in `actions' for a step from a breakpoint while other threads are
+// resumed too; if there is one, it is added to `loneStep' as an action of its
+// own.
+//
+void DebugSessionImplBase::findLoneStep(
+    ThreadResumeAction::Collection const &actions,
+    ThreadResumeAction::Collection &loneStep) {
+  SoftwareBreakpointManager *bpm = _process->softwareBreakpointManager();
+  if (bpm == nullptr || actions.size() < 2) {
+    return;
+  }
+
+  for (auto const &action : actions) {
+    if (action.action != kResumeActionSingleStep &&
+        action.action != kResumeActionSingleStepWithSignal)
+      continue;
+
+    // A global step only applies to the current thread, and only if no
+    // other action names it.
+    Thread *thread = action.ptid.any() ? _process->currentThread()
+                                       : findThread(action.ptid);
+    if (thread == nullptr)
+      continue;
+    if (action.ptid.any()) {
+      bool named = false;
+      for (auto const &other : actions) {
+        named |= (!other.ptid.any() && findThread(other.ptid) == thread);
+      }
+      if (named)
+        continue;
+    }
+
+    if (bpm->stepsFromSite(thread, action.address)) {
+      DS2LOG(Debug, "tid %" PRIu64 " steps from a breakpoint, stepping alone",
+             (uint64_t)thread->tid());
+      loneStep.push_back(action);
+      loneStep.back().ptid = ProcessThreadId(_process->pid(), thread->tid());
+      return;
+    }
+  }
+}
+
+ErrorCode DebugSessionImplBase::prepareStep(Thread *thread,
+                                            Address const &address) {
+  SoftwareBreakpointManager *bpm = _process->softwareBreakpointManager();
+  if (bpm == nullptr) {
+    return kSuccess;
+  }
+
+  return bpm->prepareStep(thread, address);
+}
+
 ErrorCode DebugSessionImplBase::onDetach(Session &, ProcessId, bool stopped) {
   SoftwareBreakpointManager *bpm = _process->softwareBreakpointManager();
   if (bpm != nullptr) {
@@ -1155,23 +1546,36 @@ ErrorCode DebugSessionImplBase::spawnProcess(StringCollection const &args,
     DS2LOG(Error, "cannot execute '%s'", args[0].c_str());
     return kErrorUnknown;
   }
+  if (_watchedFd >= 0) {
+    _process->watchDescriptor(_watchedFd, _watchedHandler);
+  }
 
   return kSuccess;
 }
 
 void DebugSessionImplBase::appendOutput(char const *buf, size_t size) {
-  for (size_t i = 0; i < size; ++i) {
-    this->_consoleBuffer += buf[i];
-    if (buf[i] == '\n') {
-      _resumeSessionLock.lock();
-      DS2ASSERT(_resumeSession != nullptr);
-      std::string data = "O";
-      data += ToHex(this->_consoleBuffer);
-      _consoleBuffer.clear();
-      this->_resumeSession->send(data);
-      _resumeSessionLock.unlock();
-    }
-  }
+  std::lock_guard<std::mutex> guard(_resumeSessionLock);
+  _consoleBuffer.append(buf, size);
+  flushOutput();
+}
+
+//
+// Sends all the complete lines of console output in a single packet. Output
+// produced while the inferior is stopped (there is no resume session) is kept
+// until the next resume. Must be called with _resumeSessionLock held.
+//
+void DebugSessionImplBase::flushOutput() {
+  if (_resumeSession == nullptr)
+    return;
+
+  size_t end = _consoleBuffer.rfind('\n');
+  if (end == std::string::npos)
+    return;
+
+  std::string data = "O";
+  data += ToHex(_consoleBuffer.substr(0, end + 1));
+  _consoleBuffer.erase(0, end + 1);
+  _resumeSession->send(data);
 }
 
 ErrorCode DebugSessionImplBase::onSendInput(Session &session,
@@ -1181,12 +1585,26 @@ ErrorCode DebugSessionImplBase::onSendInput(Session &session,
 
 ErrorCode DebugSessionImplBase::fetchStopInfoForAllThreads(
     Session &session, std::vector<StopInfo> &stops, StopInfo &processStop) {
-  CHK(onQueryThreadStopInfo(session, ProcessThreadId(), processStop));
+  Thread *current = findThread(ProcessThreadId());
+  if (current == nullptr)
+    return kErrorProcessNotFound;
+
+  //
+  // Enumerating threads refreshes the state of each of them, which is not
+  // free (on Linux it reads /proc/pid/task/tid/stat). Do it once here and
+  // describe every thread from that snapshot, rather than letting each
+  // per-thread query enumerate the whole process again.
+  //
+  std::vector<Thread *> threads;
+  _process->enumerateThreads(
+      [&](Thread *thread) { threads.push_back(thread); });
+
+  CHK(queryStopInfo(session, current, processStop, false));
 
-  for (auto const &tid : processStop.threads) {
-    StopInfo stop;
-    onQueryThreadStopInfo(session, ProcessThreadId(kAnyProcessId, tid), stop);
-    stops.push_back(stop);
+  stops.resize(threads.size());
+  for (size_t n = 0; n < threads.size(); n++) {
+    processStop.threads.insert(threads[n]->tid());
+    queryStopInfo(session, threads[n], stops[n], false);
   }
 
   return kSuccess;
@@ -217,6 +217,9 @@ DUMMY_IMPL_EMPTY(onReadMemory, Session &, Address const &, size_t, ByteVector &)
 DUMMY_IMPL_EMPTY(onWriteMemory, Session &, Address const &, ByteVector const &,
                  size_t &)
 
+DUMMY_IMPL_EMPTY(onReadMemoryVector, Session &, MemoryRange::Collection const &,
+                 std::vector<ByteVector> &)
+
 DUMMY_IMPL_EMPTY(onAllocateMemory, Session &, size_t, uint32_t, Address &)
 
 DUMMY_IMPL_EMPTY(onDeallocateMemory, Session &, Address const &)
@@ -229,8 +232,8 @@ DUMMY_IMPL_EMPTY(onComputeCRC, Session &, Address const &, size_t, uint32_t &)
 DUMMY_IMPL_EMPTY(onSearchBackward, Session &, Address const &, uint32_t,
                  uint32_t, Address &)
 
-DUMMY_IMPL_EMPTY(onSearch, Session &, Address const &, std::string const &,
-                 Address &)
+DUMMY_IMPL_EMPTY(onSearch, Session &, Address const &, size_t,
+                 std::string const &, Address &)
 
 DUMMY_IMPL_EMPTY(onInsertBreakpoint, Session &, BreakpointType, Address const &,
                  uint32_t, StringCollection const &, StringCollection const &,
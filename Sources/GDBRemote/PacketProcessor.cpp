@@ -5,127 +5,120 @@
 // source tree.
 
 #include "DebugServer2/GDBRemote/PacketProcessor.h"
-#include "DebugServer2/GDBRemote/ProtocolHelpers.h"
+#include "DebugServer2/Utils/HexValues.h"
 #include "DebugServer2/Utils/Log.h"
 
-#include <cstdlib>
+#include <cctype>
+#include <cstring>
 
 namespace ds2 {
 namespace GDBRemote {
 
 PacketProcessor::PacketProcessor()
-    : _nreqs(0), _needhash(false), _delegate(nullptr) {}
-
-bool PacketProcessor::validate() {
-  if (_buffer.empty())
-    return false;
-
-  if (_buffer[0] == '+' || _buffer[0] == '-' || _buffer[0] == '\x03')
-    return true;
-
-  size_t csoff = _buffer.find('#');
-  uint8_t csum =
-      static_cast<uint8_t>(std::strtoul(&_buffer[csoff + 1], nullptr, 16));
-
-  _buffer.erase(0, 1);
-  _buffer.erase(csoff - 1);
-
-  uint8_t our_csum = Checksum(_buffer);
-
-  if (csum != our_csum)
-    DS2LOG(Warning,
-           "received packet %s with invalid checksum, should be %.2x, is %.2x",
-           _buffer.c_str(), our_csum, csum);
-
-  return csum == our_csum;
-}
+    : _state(kStateIdle), _csum(0), _delegate(nullptr) {}
 
 void PacketProcessor::process() {
-  _delegate->onPacketData(_buffer, validate());
+  bool valid = std::isxdigit(static_cast<unsigned char>(_csumChars[0])) &&
+               std::isxdigit(static_cast<unsigned char>(_csumChars[1]));
+  if (valid) {
+    uint8_t csum = HexToByte(_csumChars);
+    valid = (csum == _csum);
+    if (!valid)
+      DS2LOG(Warning,
+             "received packet %s with invalid checksum, should be %.2x, "
+             "is %.2x",
+             _buffer.c_str(), _csum, csum);
+  } else {
+    DS2LOG(Warning, "received packet %s with malformed checksum %.2s",
+           _buffer.c_str(), _csumChars);
+  }
+
+  _delegate->onPacketData(_buffer, valid);
   _buffer.clear();
-  _nreqs = 0;
 }
 
+//
+// Packets are parsed incrementally as data comes in: the payload is appended
+// to `_buffer` without its framing, the checksum being accumulated at the same
+// time, so that nothing has to be rescanned or copied again once the trailer
+// arrives. `_buffer` keeps its capacity from one packet to the next.
+//
 void PacketProcessor::parse(std::string const &data) {
-  size_t n = _nreqs;
-
   if (data.empty() || _delegate == nullptr)
     return;
 
-  //
-  // Do we need to complete a packet?
-  //
-  if (n != 0 && data.length() != 0) {
-    _buffer += data.substr(0, n);
-    if (data.length() < _nreqs) {
-      _nreqs -= data.length();
-      if (_nreqs != 0)
-        return;
-    }
-
-    process();
-  }
+  char const *first = data.data();
+  char const *last = first + data.size();
+  char const *junk = nullptr;
+  bool processed = false;
+
+  while (first != last) {
+    switch (_state) {
+    case kStateIdle:
+      switch (*first) {
+      case '+':    // ACK
+      case '-':    // NAK
+      case '\x03': // Halt Target
+        _buffer.assign(1, *first);
+        _delegate->onPacketData(_buffer, true);
+        _buffer.clear();
+        processed = true;
+        junk = nullptr;
+        break;
+
+      case '$':
+        _buffer.clear();
+        _csum = 0;
+        _state = kStatePayload;
+        junk = nullptr;
+        break;
+
+      default:
+        if (junk == nullptr)
+          junk = first;
+        break;
+      }
+      first++;
+      break;
 
-  //
-  // First will be std::string::npos if a packet
-  // has been processed.
-  //
-  size_t first = n;
-  while (n < data.size()) {
-    size_t end = std::string::npos;
-    if (_needhash) {
-      _needhash = false;
-      goto hash;
-    }
+    case kStatePayload: {
+      char const *hash = static_cast<char const *>(
+          std::memchr(first, '#', static_cast<size_t>(last - first)));
+      char const *end = (hash != nullptr) ? hash : last;
 
-    switch (data[n]) {
-    case '+':    // ACK
-    case '-':    // NAK
-    case '\x03': // Halt Target
-      end = n + 1;
-      break;
+      uint8_t csum = _csum;
+      for (char const *p = first; p != end; p++) {
+        csum += static_cast<uint8_t>(*p);
+      }
+      _csum = csum;
+      _buffer.append(first, end);
 
-    case '$':
-    hash:
-      end = data.find('#', n);
-      if (end++ != std::string::npos) {
-        size_t avail = data.length() - end;
-        if (avail < 2) {
-          _buffer += data.substr(n);
-          _nreqs = 2 - avail;
-          return;
-        } else {
-          end += 2;
-        }
-      } else {
-        _buffer += data.substr(n);
-        _needhash = true;
-        return;
+      first = end;
+      if (hash != nullptr) {
+        first++;
+        _state = kStateChecksumHigh;
       }
-      break;
+    } break;
 
-    default:
-      n++;
-      continue;
-    }
+    case kStateChecksumHigh:
+      _csumChars[0] = *first++;
+      _state = kStateChecksumLow;
+      break;
 
-    if (end != std::string::npos) {
-      first = std::string::npos;
-      _buffer += data.substr(n, end - n);
+    case kStateChecksumLow:
+      _csumChars[1] = *first++;
+      _state = kStateIdle;
       process();
+      processed = true;
+      break;
     }
-    n = end;
   }
 
   //
-  // First is valid when there is data to add.
+  // Report garbage that was not followed by anything we could make sense of.
   //
-  if (first != std::string::npos && first < data.length()) {
-    if (_buffer.empty() && data[first] != '$') {
-      _delegate->onInvalidData(data.substr(first));
-      return;
-    }
-    _buffer += data.substr(first);
+  if (junk != nullptr && !processed) {
+    _delegate->onInvalidData(std::string(junk, last));
   }
 }
 } // namespace GDBRemote
@@ -5,12 +5,12 @@
 // source tree.
 
 #include "DebugServer2/GDBRemote/ProtocolInterpreter.h"
-#include "DebugServer2/GDBRemote/ProtocolHelpers.h"
 #include "DebugServer2/GDBRemote/Session.h"
 #include "DebugServer2/Utils/Log.h"
 
 #include <algorithm>
 #include <cstring>
+#include <iterator>
 #include <iomanip>
 #include <sstream>
 
@@ -31,10 +31,14 @@ static std::string EscapeForTerm(std::string const &s) {
   return ss.str();
 }
 
-ProtocolInterpreter::ProtocolInterpreter() : _session(nullptr) {}
+ProtocolInterpreter::ProtocolInterpreter() : _session(nullptr) {
+  std::fill(std::begin(_handlerIndex), std::end(_handlerIndex), 0);
+}
 
 void ProtocolInterpreter::onPacketData(std::string const &data, bool valid) {
-  DS2LOG(Packet, "getpkt(\"%s\")", EscapeForTerm(&data[0]).c_str());
+  if (GetLogLevel() <= kLogLevelPacket) {
+    DS2LOG(Packet, "getpkt(\"%s\")", EscapeForTerm(&data[0]).c_str());
+  }
 
   if (_session == nullptr)
     return;
@@ -102,6 +106,16 @@ void ProtocolInterpreter::onPacketData(std::string const &data, bool valid) {
     } else {
       command_end = 1;
     }
+  } else if (data.compare(0, 12, "MultiMemRead") == 0) {
+    //
+    // MultiMemRead is the only command starting with 'M' that is longer than
+    // one char, it is terminated with : (colon).
+    //
+    size_t end = data.find_first_of(":");
+    if (end != std::string::npos) {
+      command_end = end;
+      args_start = end + 1;
+    }
   } else if (data[0] == 'j') {
     //
     // The commands starting with j are terminated with : (colon)
@@ -118,23 +132,22 @@ void ProtocolInterpreter::onPacketData(std::string const &data, bool valid) {
     command_end = 1;
   }
 
-  if (args_start == std::string::npos && command_end < data.length()) {
+  if (command_end > data.length()) {
+    command_end = data.length();
+  }
+
+  if (args_start == std::string::npos) {
     //
     // Arguments follow the command with no separator.
     //
     args_start = command_end;
   }
 
-  std::string command = data.substr(0, command_end);
-  std::string args;
-  if (args_start != std::string::npos) {
-    args = data.substr(args_start);
-  }
-
   //
   // Find the handler and execute it.
   //
-  onCommand(command, args);
+  dispatch(data.data(), command_end, data.data() + args_start,
+           data.length() - args_start);
 }
 
 void ProtocolInterpreter::onInvalidData(std::string const &data) {
@@ -148,10 +161,18 @@ void ProtocolInterpreter::onInvalidData(std::string const &data) {
 
 void ProtocolInterpreter::onCommand(std::string const &command,
                                     std::string const &arguments) {
+  dispatch(command.data(), command.length(), arguments.data(),
+           arguments.length());
+}
+
+void ProtocolInterpreter::dispatch(char const *command, size_t length,
+                                   char const *arguments,
+                                   size_t argumentsLength) {
   size_t commandLength;
-  Handler const *handler = findHandler(command, commandLength);
+  Handler const *handler = findHandler(command, length, commandLength);
   if (handler == nullptr) {
-    DS2LOG(Packet, "handler for command '%s' unknown", command.c_str());
+    DS2LOG(Packet, "handler for command '%.*s' unknown",
+           static_cast<int>(length), command);
 
     //
     // The handler couldn't be found, we don't support this packet.
@@ -160,18 +181,27 @@ void ProtocolInterpreter::onCommand(std::string const &command,
     return;
   }
 
-  std::string extra;
-  if (commandLength != command.length()) {
-    //
-    // Command has part of the argument, LLDB doesn't use separators :(
-    //
-    extra = command.substr(commandLength);
-  }
-
-  extra += arguments;
-
-  if (extra.find_first_of("*}") != std::string::npos) {
-    extra = Unescape(extra);
+  //
+  // Command may have part of the argument, LLDB doesn't use separators :(
+  // The arguments are put together in the same buffer from one packet to the
+  // next, and unescaped in place, so that dispatching does not allocate.
+  //
+  std::string &extra = _argumentsBuffer;
+  extra.assign(command + commandLength, length - commandLength);
+  extra.append(arguments, argumentsLength);
+
+  size_t escape = extra.find('}');
+  if (escape != std::string::npos) {
+    size_t out = escape;
+    for (size_t in = escape; in < extra.length(); in++) {
+      if (extra[in] == '}' && in + 1 < extra.length()) {
+        in++;
+        extra[out++] = extra[in] ^ 0x20;
+      } else {
+        extra[out++] = extra[in];
+      }
+    }
+    extra.resize(out);
     DS2LOG(Packet, "args='%.*s'", static_cast<int>(extra.length()), &extra[0]);
   }
 
@@ -184,7 +214,8 @@ bool ProtocolInterpreter::registerHandler(Handler const &handler) {
     return false;
 
   size_t commandLength;
-  if (findHandler(handler.command, commandLength))
+  if (findHandler(handler.command.data(), handler.command.length(),
+                  commandLength))
     return false;
 
   _handlers.push_back(handler);
@@ -195,20 +226,41 @@ bool ProtocolInterpreter::registerHandler(Handler const &handler) {
               return (a.command < b.command);
             });
 
+  //
+  // Rebuild the first-char index; the sort keeps all the handlers sharing the
+  // same first char together.
+  //
+  size_t n = 0;
+  for (size_t c = 0; c < 256; c++) {
+    _handlerIndex[c] = n;
+    while (n < _handlers.size() &&
+           static_cast<uint8_t>(_handlers[n].command[0]) == c) {
+      n++;
+    }
+  }
+  _handlerIndex[256] = n;
+
   return true;
 }
 
 ProtocolInterpreter::Handler const *
-ProtocolInterpreter::findHandler(std::string const &command,
+ProtocolInterpreter::findHandler(char const *command, size_t length,
                                  size_t &commandLength) const {
-  auto it = std::lower_bound(
-      _handlers.begin(), _handlers.end(), command,
-      [](Handler const &handler, std::string const &command) -> bool {
-        return handler.compare(command) < 0;
-      });
+  if (length == 0)
+    return nullptr;
+
+  uint8_t c = static_cast<uint8_t>(command[0]);
+  auto first = _handlers.begin() + _handlerIndex[c];
+  auto last = _handlers.begin() + _handlerIndex[c + 1];
+
+  auto it = std::lower_bound(first, last, command,
+                             [length](Handler const &handler,
+                                      char const *command) -> bool {
+                               return handler.compare(command, length) < 0;
+                             });
 
   Handler const *handler = nullptr;
-  if (it != _handlers.end() && it->compare(command) == 0) {
+  if (it != last && it->compare(command, length) == 0) {
     commandLength = it->command.length();
     handler = &(*it);
   }
@@ -216,12 +268,12 @@ ProtocolInterpreter::findHandler(std::string const &command,
   return handler;
 }
 
-int ProtocolInterpreter::Handler::compare(std::string const &command_) const {
-  if (mode == Handler::kModeEquals) {
-    return command.compare(command_);
-  } else {
-    return command.compare(command_.substr(0, command.length()));
+int ProtocolInterpreter::Handler::compare(char const *command_,
+                                          size_t length) const {
+  if (mode == Handler::kModeStartsWith && length > command.length()) {
+    length = command.length();
   }
+  return command.compare(0, std::string::npos, command_, length);
 }
 } // namespace GDBRemote
 } // namespace ds2
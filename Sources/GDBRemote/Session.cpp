@@ -12,6 +12,7 @@
 #include "DebugServer2/Utils/String.h"
 #include "DebugServer2/Utils/SwapEndian.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
@@ -75,12 +76,14 @@ Session::Session(CompatibilityMode mode)
   REGISTER_HANDLER_EQUALS_1(_M);
   REGISTER_HANDLER_EQUALS_1(_m);
   REGISTER_HANDLER_EQUALS_1(M);
+  REGISTER_HANDLER_EQUALS_1(MultiMemRead);
   REGISTER_HANDLER_EQUALS_1(m);
   REGISTER_HANDLER_EQUALS_1(P);
   REGISTER_HANDLER_EQUALS_1(p);
   REGISTER_HANDLER_EQUALS_1(QAgent);
   REGISTER_HANDLER_EQUALS_1(QAllow);
   REGISTER_HANDLER_EQUALS_1(QDisableRandomization);
+  REGISTER_HANDLER_EQUALS_1(QEnableCompression);
   REGISTER_HANDLER_EQUALS_1(QEnvironment);
   REGISTER_HANDLER_EQUALS_1(QEnvironmentHexEncoded);
   REGISTER_HANDLER_EQUALS_1(QLaunchArch);
@@ -772,7 +775,7 @@ void Session::Handle_H(ProtocolInterpreter::Handler const &,
 void Session::Handle_I(ProtocolInterpreter::Handler const &,
                        std::string const &args) {
   if (_compatMode == kCompatibilityModeLLDB) {
-    ByteVector data(HexToByteVector(args.data()));
+    ByteVector data(HexToByteVector(args));
     CHK_SEND(_delegate->onSendInput(*this, data));
 
     sendOK();
@@ -976,7 +979,8 @@ void Session::Handle_M(ProtocolInterpreter::Handler const &,
     return;
   }
 
-  ByteVector data(HexToByteVector(eptr));
+  ByteVector data(
+      HexToByteVector(eptr, args.length() - (eptr - args.c_str())));
   if (data.size() > length) {
     data.resize(length);
   }
@@ -1009,6 +1013,72 @@ void Session::Handle_m(ProtocolInterpreter::Handler const &,
   send(ToHex(data));
 }
 
+//
+// Packet:        MultiMemRead:ranges:addr,length[,addr,length...];
+// Description:   Read several ranges of target memory at once. The reply is
+//                the comma-separated list of the number of bytes read for
+//                each range, a semi-colon, then the bytes of all ranges in
+//                binary. Ranges are cut short so that the reply stays within
+//                the packet size.
+// Compatibility: LLDB
+//
+void Session::Handle_MultiMemRead(ProtocolInterpreter::Handler const &,
+                                  std::string const &args) {
+  MemoryRange::Collection ranges;
+  uint64_t budget = kMaxPacketSize;
+  bool valid = true;
+
+  ParseList(args, ';', [&](std::string const &option) {
+    size_t colon = option.find(':');
+    if (colon == std::string::npos || option.substr(0, colon) != "ranges")
+      return;
+
+    std::vector<uint64_t> values;
+    ParseList(option.substr(colon + 1), ',', [&](std::string const &value) {
+      char *eptr;
+      values.push_back(strtoull(value.c_str(), &eptr, 16));
+      if (value.empty() || *eptr != '\0') {
+        valid = false;
+      }
+    });
+
+    if (values.size() % 2 != 0) {
+      valid = false;
+      return;
+    }
+
+    for (size_t n = 0; n < values.size(); n += 2) {
+      uint64_t length = std::min<uint64_t>(values[n + 1], budget);
+      ranges.emplace_back(values[n], length);
+      budget -= length;
+    }
+  });
+
+  if (!valid || ranges.empty()) {
+    sendError(kErrorInvalidArgument);
+    return;
+  }
+
+  std::vector<ByteVector> data;
+  CHK_SEND(_delegate->onReadMemoryVector(*this, ranges, data));
+
+  std::ostringstream ss;
+  for (size_t n = 0; n < data.size(); n++) {
+    if (n != 0) {
+      ss << ',';
+    }
+    ss << std::hex << data[n].size();
+  }
+  ss << ';';
+
+  std::string reply = ss.str();
+  for (auto const &buffer : data) {
+    reply.append(buffer.begin(), buffer.end());
+  }
+
+  send(reply);
+}
+
 //
 // Packet:        P n=r
 // Description:   Write register n value r
@@ -1211,6 +1281,50 @@ void Session::Handle_QRestoreRegisterState(ProtocolInterpreter::Handler const &,
   sendError(_delegate->onRestoreRegisters(*this, ptid, id));
 }
 
+//
+// Packet:        QEnableCompression:type:<type>;[minsize:<size>;]
+// Description:   Compress the packets we send from now on with the specified
+//                algorithm, which has to be one of those we advertised in
+//                SupportedCompressions. Packets smaller than minsize (decimal)
+//                are not worth compressing and are sent as-is.
+// Compatibility: LLDB
+//
+void Session::Handle_QEnableCompression(ProtocolInterpreter::Handler const &,
+                                        std::string const &args) {
+  std::string type;
+  size_t minSize = 384;
+
+  ParseList(args, ';', [&](std::string const &arg) {
+    size_t colon = arg.find(':');
+    if (colon == std::string::npos)
+      return;
+
+    std::string key = arg.substr(0, colon);
+    if (key == "type") {
+      type = arg.substr(colon + 1);
+    } else if (key == "minsize") {
+      minSize = std::strtoul(arg.c_str() + colon + 1, nullptr, 10);
+    }
+  });
+
+  if (_compatMode != kCompatibilityModeLLDB || type.empty()) {
+    sendError(kErrorInvalidArgument);
+    return;
+  }
+
+  CompressionType compression = GetCompressionType(type);
+  if (compression == kCompressionNone) {
+    sendError(kErrorUnsupported);
+    return;
+  }
+
+  //
+  // The reply to this packet is the last one that goes out uncompressed.
+  //
+  sendOK();
+  setCompression(compression, minSize);
+}
+
 //
 // Packet:        QStartNoAckMode
 // Description:   Request that the remote stub disable the normal
@@ -1518,7 +1632,7 @@ void Session::Handle_qC(ProtocolInterpreter::Handler const &,
 
 //
 // Packet:        qCRC addr,length
-// Description:   Compute CRC of the target memory
+// Description:   Compute CRC of the target memory, the reply is Ccrc32
 // Compatibility: GDB
 //
 void Session::Handle_qCRC(ProtocolInterpreter::Handler const &,
@@ -1539,7 +1653,7 @@ void Session::Handle_qCRC(ProtocolInterpreter::Handler const &,
   CHK_SEND(_delegate->onComputeCRC(*this, address, length, crc));
 
   std::ostringstream ss;
-  ss << std::hex << std::setw(8) << std::setfill('0') << crc;
+  ss << 'C' << std::hex << std::setw(8) << std::setfill('0') << crc;
   send(ss.str());
 }
 
@@ -2085,9 +2199,14 @@ void Session::Handle_qSearch(ProtocolInterpreter::Handler const &,
     return;
   }
 
+  //
+  // The pattern is binary and extends to the end of the packet.
+  //
+  std::string pattern = args.substr(eptr - args.c_str());
+
   Address location;
-  ErrorCode error = _delegate->onSearch(
-      *this, address, std::string(HexToString(eptr), length), location);
+  ErrorCode error =
+      _delegate->onSearch(*this, address, length, pattern, location);
   if (error != kSuccess && error != kErrorNotFound) {
     sendError(error);
     return;
@@ -2097,7 +2216,7 @@ void Session::Handle_qSearch(ProtocolInterpreter::Handler const &,
   if (error == kErrorNotFound) {
     ss << '0';
   } else {
-    ss << '1' << ',' << formatAddress(address, kEndianBig);
+    ss << '1' << ',' << formatAddress(location, kEndianBig);
   }
   send(ss.str());
 }
@@ -2210,6 +2329,16 @@ void Session::Handle_qSupported(ProtocolInterpreter::Handler const &,
 
   CHK_SEND(_delegate->onQuerySupported(*this, remoteFeatures, localFeatures));
 
+  //
+  // Compression happens at the session level, the delegate has no say in it.
+  //
+  if (_compatMode == kCompatibilityModeLLDB) {
+    std::string compressions = SupportedCompressions();
+    if (!compressions.empty()) {
+      localFeatures.push_back("SupportedCompressions=" + compressions);
+    }
+  }
+
   //
   // Build the local features response.
   //
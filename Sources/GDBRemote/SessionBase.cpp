@@ -9,14 +9,24 @@
 #include "DebugServer2/Utils/HexValues.h"
 #include "DebugServer2/Utils/Log.h"
 
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(HAVE_LZ4)
+#include <lz4.h>
+#endif
 
 namespace ds2 {
 namespace GDBRemote {
 
 SessionBase::SessionBase(CompatibilityMode mode)
-    : _channel(nullptr), _delegate(nullptr), _ackmode(true), _compatMode(mode) {
+    : _channel(nullptr), _delegate(nullptr), _ackmode(true),
+      _runLengthEncoding(false), _compression(kCompressionNone),
+      _compressionMinSize(0), _compatMode(mode) {
   _processor.setDelegate(&_interpreter);
   _interpreter.setSession(this);
 }
@@ -36,7 +46,11 @@ bool SessionBase::receive(bool cooked) {
   if (!_channel->wait())
     return false;
 
-  std::string data;
+  //
+  // Reuse the same buffer from one packet to the next so that, with a
+  // QueueChannel, receiving does not allocate.
+  //
+  std::string &data = _receiveBuffer;
 
   if (!_channel->receive(data))
     return false;
@@ -98,6 +112,265 @@ void SessionBase::onInvalidData(std::string const &) {
 //
 // Send commands
 //
+
+//
+// Frames and sends a packet. If the payload needs no escaping, it is sent
+// as-is between the header and the trailer; otherwise it is escaped into a
+// buffer that is kept across calls. The checksum is computed in the same pass
+// that looks for characters to escape.
+//
+// When run-length encoding is enabled, runs of more than three identical
+// characters are sent as `c*N`, where N - 29 is the number of additional
+// repeats. N must be printable and cannot be '#' or '$', which caps the
+// repeat count at 97 and rules out 6 and 7.
+//
+bool SessionBase::sendPacket(char const *data, size_t length, bool escaped) {
+  static size_t const kMinRepeat = 3;
+  static size_t const kMaxRepeat = 126 - 29;
+
+  if (_compression != kCompressionNone)
+    return sendCompressedPacket(data, length, escaped);
+
+  bool rle = _runLengthEncoding && !escaped;
+  uint8_t csum = 0;
+  size_t n = 0;
+
+  if (rle) {
+    // Always go through the buffer below.
+  } else if (!escaped) {
+    for (; n < length; n++) {
+      char c = data[n];
+      if (c == '$' || c == '#' || c == '}' || c == '*')
+        break;
+      csum += c;
+    }
+  } else {
+    for (; n < length; n++) {
+      csum += data[n];
+    }
+  }
+
+  char trailer[3];
+  trailer[0] = '#';
+
+  if (n == length) {
+    trailer[1] = NibbleToHex(csum >> 4);
+    trailer[2] = NibbleToHex(csum & 15);
+
+    DS2LOG(Packet, "putpkt(\"$%.*s#%.2s\", %u)", static_cast<int>(length),
+           data, trailer + 1, static_cast<unsigned>(length + 4));
+
+    Host::Channel::Buffer buffers[] = {
+        {"$", 1}, {data, length}, {trailer, sizeof(trailer)}};
+    return _channel->sendv(buffers, sizeof(buffers) / sizeof(buffers[0]));
+  }
+
+  //
+  // Some characters need escaping, or we want to compress runs: copy what we
+  // have scanned so far and encode the rest as we go.
+  //
+  _sendBuffer.clear();
+  _sendBuffer.reserve(length + (length - n) / 8 + 8);
+  _sendBuffer += '$';
+  _sendBuffer.append(data, n);
+  while (n < length) {
+    char c = data[n];
+    if (c == '$' || c == '#' || c == '}' || c == '*') {
+      _sendBuffer += '}';
+      csum += '}';
+      c ^= 0x20;
+      _sendBuffer += c;
+      csum += c;
+      n++;
+      continue;
+    }
+
+    _sendBuffer += c;
+    csum += c;
+    n++;
+
+    if (!rle)
+      continue;
+
+    size_t repeat = 0;
+    while (n + repeat < length && data[n + repeat] == c &&
+           repeat < kMaxRepeat) {
+      repeat++;
+    }
+    if (repeat < kMinRepeat)
+      continue;
+    if (repeat == 6 || repeat == 7) {
+      repeat = 5;
+    }
+
+    char count = static_cast<char>(repeat + 29);
+    _sendBuffer += '*';
+    _sendBuffer += count;
+    csum += '*';
+    csum += count;
+    n += repeat;
+  }
+
+  trailer[1] = NibbleToHex(csum >> 4);
+  trailer[2] = NibbleToHex(csum & 15);
+  _sendBuffer.append(trailer, sizeof(trailer));
+
+  DS2LOG(Packet, "putpkt(\"%s\", %u)", _sendBuffer.c_str(),
+         static_cast<unsigned>(_sendBuffer.length()));
+
+  // sendv() goes on until the whole packet is out, send() might stop short.
+  Host::Channel::Buffer buffer = {_sendBuffer.data(), _sendBuffer.size()};
+  return _channel->sendv(&buffer, 1);
+}
+
+//
+// Packet compression, as negotiated by LLDB with QEnableCompression.
+//
+static bool Compress(CompressionType type, std::string const &input,
+                     ByteVector &output) {
+  switch (type) {
+#if defined(HAVE_ZLIB)
+  case kCompressionZlib: {
+    //
+    // LLDB expects a raw deflate stream, with no zlib header or trailer,
+    // hence the negative window bits.
+    //
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+      return false;
+
+    output.resize(deflateBound(&stream, input.size()));
+    stream.next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = output.data();
+    stream.avail_out = static_cast<uInt>(output.size());
+
+    int rc = deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return rc == Z_STREAM_END;
+  }
+#endif
+
+#if defined(HAVE_LZ4)
+  case kCompressionLZ4: {
+    // LLDB expects a raw LZ4 block, not a frame.
+    output.resize(LZ4_compressBound(static_cast<int>(input.size())));
+    int size = LZ4_compress_default(
+        input.data(), reinterpret_cast<char *>(output.data()),
+        static_cast<int>(input.size()), static_cast<int>(output.size()));
+    if (size <= 0)
+      return false;
+    output.resize(size);
+    return true;
+  }
+#endif
+
+  default:
+    return false;
+  }
+}
+
+static struct {
+  char const *name;
+  CompressionType type;
+} const kCompressionTypes[] = {
+#if defined(HAVE_ZLIB)
+    {"zlib-deflate", kCompressionZlib},
+#endif
+#if defined(HAVE_LZ4)
+    {"lz4", kCompressionLZ4},
+#endif
+    {nullptr, kCompressionNone},
+};
+
+std::string SessionBase::SupportedCompressions() {
+  std::string result;
+  for (auto const &compression : kCompressionTypes) {
+    if (compression.name == nullptr)
+      break;
+    if (!result.empty()) {
+      result += ',';
+    }
+    result += compression.name;
+  }
+  return result;
+}
+
+CompressionType SessionBase::GetCompressionType(std::string const &name) {
+  for (auto const &compression : kCompressionTypes) {
+    if (compression.name != nullptr && name == compression.name)
+      return compression.type;
+  }
+  return kCompressionNone;
+}
+
+void SessionBase::setCompression(CompressionType type, size_t minSize) {
+  DS2LOG(Debug, "using compression type %d for packets of %zu bytes or more",
+         type, minSize);
+  _compression = type;
+  _compressionMinSize = minSize;
+}
+
+//
+// Once compression is enabled, every packet has its payload prefixed with
+// `N` when it is sent as-is, or is sent as `C<size>:<compressed data>`, where
+// <size> is the decimal size of the uncompressed payload. The payload is
+// escaped before compression, and the compressed data is escaped again.
+//
+bool SessionBase::sendCompressedPacket(char const *data, size_t length,
+                                       bool escaped) {
+  _compressInput.clear();
+  for (size_t n = 0; n < length; n++) {
+    char c = data[n];
+    if (!escaped && (c == '$' || c == '#' || c == '}' || c == '*')) {
+      _compressInput += '}';
+      c ^= 0x20;
+    }
+    _compressInput += c;
+  }
+
+  _sendBuffer.assign(1, '$');
+  if (_compressInput.size() >= _compressionMinSize &&
+      Compress(_compression, _compressInput, _compressOutput) &&
+      _compressOutput.size() < _compressInput.size()) {
+    char header[32];
+    int headerLength = std::snprintf(header, sizeof(header), "C%zu:",
+                                     _compressInput.size());
+    _sendBuffer.append(header, headerLength);
+    for (uint8_t byte : _compressOutput) {
+      char c = static_cast<char>(byte);
+      if (c == '$' || c == '#' || c == '}' || c == '*') {
+        _sendBuffer += '}';
+        c ^= 0x20;
+      }
+      _sendBuffer += c;
+    }
+  } else {
+    _sendBuffer += 'N';
+    _sendBuffer += _compressInput;
+  }
+
+  uint8_t csum = 0;
+  for (size_t n = 1; n < _sendBuffer.size(); n++) {
+    csum += _sendBuffer[n];
+  }
+  _sendBuffer += '#';
+  _sendBuffer += NibbleToHex(csum >> 4);
+  _sendBuffer += NibbleToHex(csum & 15);
+
+  DS2LOG(Packet, "putpkt(%c, %u bytes, %u uncompressed)", _sendBuffer[1],
+         static_cast<unsigned>(_sendBuffer.size()),
+         static_cast<unsigned>(_compressInput.size()));
+
+  // As in sendPacket(), make sure the whole frame goes out.
+  Host::Channel::Buffer buffer = {_sendBuffer.data(), _sendBuffer.size()};
+  return _channel->sendv(&buffer, 1);
+}
+
 bool SessionBase::sendACK() { return _channel->send("+", 1) == 1; }
 
 bool SessionBase::sendNAK() { return _channel->send("-", 1) == 1; }
@@ -37,9 +37,17 @@ namespace GDBRemote {
 // feature+ or feature- or feature? or feature=value
 //
 bool Feature::parse(std::string const &string) {
-  size_t pos = string.find_last_of("?+-=");
-  if (pos == std::string::npos)
-    return false;
+  //
+  // Values may contain any of the flag characters (e.g.
+  // SupportedCompressions=zlib-deflate), so look for the first '=' before
+  // looking for a trailing flag.
+  //
+  size_t pos = string.find('=');
+  if (pos == std::string::npos) {
+    pos = string.find_last_of("?+-");
+    if (pos == std::string::npos)
+      return false;
+  }
 
   name = string.substr(0, pos);
   switch (string[pos]) {
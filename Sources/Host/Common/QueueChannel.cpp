@@ -40,6 +40,13 @@ ssize_t QueueChannel::send(void const *buffer, size_t length) {
   return _remote->send(buffer, length);
 }
 
+bool QueueChannel::sendv(Buffer const *buffers, size_t count) {
+  if (!connected())
+    return false;
+
+  return _remote->sendv(buffers, count);
+}
+
 //
 // This method is for compatibility, the code should always call
 // receive(std::string&) when using a QueueChannel, which is the
@@ -59,7 +66,7 @@ bool QueueChannel::receive(std::string &buffer) {
   if (!connected())
     return false;
 
-  buffer = _queue.get(0);
+  _queue.get(buffer, 0);
   return true;
 }
 } // namespace Host
@@ -26,6 +26,7 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <poll.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #define SOCK_ERRNO errno
@@ -37,6 +38,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstring>
+#include <vector>
 
 using ds2::Utils::Stringify;
 
@@ -343,6 +345,111 @@ ssize_t Socket::send(void const *buffer, size_t length) {
   return nsent;
 }
 
+#if defined(OS_POSIX)
+bool Socket::sendv(Buffer const *buffers, size_t count) {
+  static size_t const kMaxBuffers = 8;
+  if (count > kMaxBuffers) {
+    return Channel::sendv(buffers, count);
+  }
+
+  if (!connected()) {
+    return false;
+  }
+
+  struct iovec iov[kMaxBuffers];
+  for (size_t n = 0; n < count; n++) {
+    iov[n].iov_base = const_cast<void *>(buffers[n].data);
+    iov[n].iov_len = buffers[n].length;
+  }
+
+  //
+  // Keep going until everything went out, the kernel may take only part of
+  // the data when the socket buffer is full. The socket is non-blocking, so
+  // wait for room rather than leave part of a packet on the wire.
+  //
+  struct iovec *first = iov;
+  struct iovec *last = iov + count;
+  while (first != last) {
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = first;
+    msg.msg_iovlen = last - first;
+
+    ssize_t nsent = ::sendmsg(_handle, &msg, 0);
+    if (nsent < 0) {
+      int err = SOCK_ERRNO;
+      if (err == EINTR)
+        continue;
+      if (err == SOCK_WOULDBLOCK) {
+        struct pollfd pfd;
+        pfd.fd = _handle;
+        pfd.events = POLLOUT;
+        if (::poll(&pfd, 1, -1) >= 0 || errno == EINTR)
+          continue;
+        err = errno;
+      }
+      close();
+      _lastError = err;
+      return false;
+    }
+
+    while (first != last && static_cast<size_t>(nsent) >= first->iov_len) {
+      nsent -= first->iov_len;
+      first++;
+    }
+    if (first != last) {
+      first->iov_base = static_cast<char *>(first->iov_base) + nsent;
+      first->iov_len -= nsent;
+    }
+  }
+
+  return true;
+}
+#endif
+
+#if defined(OS_POSIX)
+//
+// Passes a set of descriptors to the peer of a UNIX socket, along with a
+// single byte of data (some systems don't deliver ancillary data alone).
+//
+bool Socket::sendDescriptors(int const *fds, size_t count) {
+  if (!connected()) {
+    return false;
+  }
+
+  char byte = 0;
+  struct iovec iov;
+  iov.iov_base = &byte;
+  iov.iov_len = 1;
+
+  std::vector<char> control(CMSG_SPACE(count * sizeof(int)));
+
+  struct msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+  ::memcpy(CMSG_DATA(cmsg), fds, count * sizeof(int));
+
+  ssize_t nsent;
+  do {
+    nsent = ::sendmsg(_handle, &msg, 0);
+  } while (nsent < 0 && errno == EINTR);
+
+  if (nsent != 1) {
+    _lastError = SOCK_ERRNO;
+    return false;
+  }
+  return true;
+}
+#endif
+
 ssize_t Socket::receive(void *buffer, size_t length) {
   if (!connected()) {
     return -1;
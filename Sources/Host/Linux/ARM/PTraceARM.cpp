@@ -24,28 +24,42 @@ namespace ds2 {
 namespace Host {
 namespace Linux {
 
-ErrorCode PTrace::readCPUState(ProcessThreadId const &ptid, ProcessInfo const &,
-                               Architecture::CPUState &state) {
+ErrorCode PTrace::readCPUStateSets(ProcessThreadId const &ptid,
+                                   ProcessInfo const &,
+                                   Architecture::CPUState &state,
+                                   uint32_t sets) {
   pid_t pid;
   CHK(ptidToPid(ptid, pid));
 
   //
   // Read GPRs
   //
-  struct pt_regs gprs;
-  if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
-    return Platform::TranslateError();
-
-  //
-  // The layout is identical.
-  //
-  std::memcpy(state.gp.regs, gprs.uregs, sizeof(state.gp.regs));
+  if (sets & Architecture::kRegisterSetGP) {
+    struct pt_regs gprs;
+    if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
+      return Platform::TranslateError();
+
+    //
+    // The layout is identical.
+    //
+    std::memcpy(state.gp.regs, gprs.uregs, sizeof(state.gp.regs));
+    state.populatedSets |= Architecture::kRegisterSetGP;
+  }
 
   static_assert(sizeof(state.vfp) == ARM_VFPREGS_SIZE,
                 "sizeof(ARM::CPUState.vfp) does not match ARM_VFPREGS_SIZE");
 
-  if (wrapPtrace(PTRACE_GETVFPREGS, pid, nullptr, &state.vfp) < 0)
-    return Platform::TranslateError();
+  if (sets & Architecture::kRegisterSetFP) {
+    if (wrapPtrace(PTRACE_GETVFPREGS, pid, nullptr, &state.vfp) < 0)
+      return Platform::TranslateError();
+    state.populatedSets |= Architecture::kRegisterSetFP;
+  }
+
+  //
+  // Hardware stoppoints are managed through the HBP registers directly and
+  // are not part of the state we transfer.
+  //
+  state.populatedSets |= (sets & Architecture::kRegisterSetDebug);
 
   return kSuccess;
 }
@@ -86,31 +100,36 @@ int PTrace::getMaxWatchpointSize(ProcessThreadId const &ptid) {
   return (getStoppointData(ptid) >> 16) & 0xff;
 }
 
-ErrorCode PTrace::writeCPUState(ProcessThreadId const &ptid,
-                                ProcessInfo const &,
-                                Architecture::CPUState const &state) {
+ErrorCode PTrace::writeCPUStateSets(ProcessThreadId const &ptid,
+                                    ProcessInfo const &,
+                                    Architecture::CPUState const &state,
+                                    uint32_t sets) {
   pid_t pid;
   CHK(ptidToPid(ptid, pid));
 
   //
-  // Read GPRs
+  // Write GPRs
   //
-  struct pt_regs gprs;
+  if (sets & Architecture::kRegisterSetGP) {
+    struct pt_regs gprs;
 
-  //
-  // The layout is identical.
-  //
-  std::memcpy(gprs.uregs, state.gp.regs, sizeof(state.gp.regs));
-  gprs.ARM_ORIG_r0 = 0;
+    //
+    // The layout is identical.
+    //
+    std::memcpy(gprs.uregs, state.gp.regs, sizeof(state.gp.regs));
+    gprs.ARM_ORIG_r0 = 0;
 
-  if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
-    return Platform::TranslateError();
+    if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
+      return Platform::TranslateError();
+  }
 
   static_assert(sizeof(state.vfp) == ARM_VFPREGS_SIZE,
                 "sizeof(ARM::CPUState.vfp) does not match ARM_VFPREGS_SIZE");
 
-  if (wrapPtrace(PTRACE_SETVFPREGS, pid, nullptr, &state.vfp) < 0)
-    return Platform::TranslateError();
+  if (sets & Architecture::kRegisterSetFP) {
+    if (wrapPtrace(PTRACE_SETVFPREGS, pid, nullptr, &state.vfp) < 0)
+      return Platform::TranslateError();
+  }
 
   return kSuccess;
 }
@@ -46,28 +46,37 @@ int PTrace::getMaxHardwareWatchpoints(ProcessThreadId const &ptid) {
   return getMaxStoppoints(ptid, NT_ARM_HW_WATCH);
 }
 
-ErrorCode PTrace::readCPUState(ProcessThreadId const &ptid,
-                               ProcessInfo const &pinfo,
-                               Architecture::CPUState &state) {
+ErrorCode PTrace::readCPUStateSets(ProcessThreadId const &ptid,
+                                   ProcessInfo const &pinfo,
+                                   Architecture::CPUState &state,
+                                   uint32_t sets) {
   state.isA32 = pinfo.pointerSize == sizeof(uint32_t);
 
   // Read GPRs.
-  struct user_pt_regs gprs;
-  CHK(readRegisterSet(ptid, NT_PRSTATUS, &gprs, sizeof(gprs)));
-  // The layout is identical.
-  std::memcpy(state.state64.gp.regs, &gprs, sizeof(state.state64.gp.regs));
+  if (sets & Architecture::kRegisterSetGP) {
+    struct user_pt_regs gprs;
+    CHK(readRegisterSet(ptid, NT_PRSTATUS, &gprs, sizeof(gprs)));
+    // The layout is identical.
+    std::memcpy(state.state64.gp.regs, &gprs, sizeof(state.state64.gp.regs));
+  }
+
+  // Only GPRs are transferred for now; the other sets are trivially present.
+  state.populatedSets |= sets;
 
   return kSuccess;
 }
 
-ErrorCode PTrace::writeCPUState(ProcessThreadId const &ptid,
-                                ProcessInfo const &,
-                                Architecture::CPUState const &state) {
+ErrorCode PTrace::writeCPUStateSets(ProcessThreadId const &ptid,
+                                    ProcessInfo const &,
+                                    Architecture::CPUState const &state,
+                                    uint32_t sets) {
   // Write GPRs.
-  struct user_pt_regs gprs;
-  // The layout is identical.
-  std::memcpy(&gprs, state.state64.gp.regs, sizeof(state.state64.gp.regs));
-  CHK(writeRegisterSet(ptid, NT_PRSTATUS, &gprs, sizeof(gprs)));
+  if (sets & Architecture::kRegisterSetGP) {
+    struct user_pt_regs gprs;
+    // The layout is identical.
+    std::memcpy(&gprs, state.state64.gp.regs, sizeof(state.state64.gp.regs));
+    CHK(writeRegisterSet(ptid, NT_PRSTATUS, &gprs, sizeof(gprs)));
+  }
 
   return kSuccess;
 }
@@ -13,10 +13,12 @@
 #include <csignal>
 #include <cstddef>
 #include <cstdio>
+#include <fcntl.h>
 #include <limits>
 #include <sys/uio.h>
 #include <sys/user.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
 #define super ds2::Host::POSIX::PTrace
 
@@ -24,6 +26,14 @@ namespace ds2 {
 namespace Host {
 namespace Linux {
 
+bool PTrace::sSeizeMode = false;
+
+PTrace::PTrace() : _seize(sSeizeMode), _seizeGate{-1, -1} {}
+
+PTrace::~PTrace() { closeSeizeGate(); }
+
+void PTrace::SetSeizeMode(bool enable) { sSeizeMode = enable; }
+
 ErrorCode PTrace::wait(ProcessThreadId const &ptid, int *status) {
   pid_t pid;
   CHK(ptidToPid(ptid, pid));
@@ -42,6 +52,25 @@ ErrorCode PTrace::wait(ProcessThreadId const &ptid, int *status) {
   return kSuccess;
 }
 
+//
+// Called before spawning a child in seize mode. The child blocks on this pipe
+// until we have seized it; if we can't create it, fall back to
+// PTRACE_TRACEME.
+//
+ErrorCode PTrace::prepareTraceMe() {
+  if (!_seize)
+    return kSuccess;
+
+  closeSeizeGate();
+  if (::pipe2(_seizeGate, O_CLOEXEC) < 0) {
+    DS2LOG(Warning, "unable to create seize gate, error=%s", strerror(errno));
+    _seize = false;
+    return Platform::TranslateError();
+  }
+
+  return kSuccess;
+}
+
 ErrorCode PTrace::traceMe(bool disableASLR) {
   if (disableASLR) {
     int persona = ::personality(std::numeric_limits<uint32_t>::max());
@@ -50,19 +79,30 @@ ErrorCode PTrace::traceMe(bool disableASLR) {
     }
   }
 
-  return super::traceMe(false);
+  if (!_seize)
+    return super::traceMe(false);
+
+  ::close(_seizeGate[1]);
+
+  char c;
+  ssize_t ret;
+  do {
+    ret = ::read(_seizeGate[0], &c, 1);
+  } while (ret < 0 && errno == EINTR);
+  ::close(_seizeGate[0]);
+
+  // The parent closes the pipe without writing if it couldn't seize us.
+  return ret == 1 ? kSuccess : kErrorProcessNotFound;
 }
 
 ErrorCode PTrace::traceThat(ProcessId pid) {
   if (pid <= 0)
     return kErrorInvalidArgument;
 
-  unsigned long traceFlags = PTRACE_O_TRACECLONE;
-
   //
   // Trace clone and exit events to track threads.
   //
-  if (wrapPtrace(PTRACE_SETOPTIONS, pid, nullptr, traceFlags) < 0) {
+  if (wrapPtrace(PTRACE_SETOPTIONS, pid, nullptr, traceOptions()) < 0) {
     DS2LOG(Warning, "unable to set PTRACE_O_TRACECLONE on pid %d, error=%s",
            pid, strerror(errno));
     return Platform::TranslateError();
@@ -71,6 +111,59 @@ ErrorCode PTrace::traceThat(ProcessId pid) {
   return kSuccess;
 }
 
+ErrorCode PTrace::attach(ProcessId pid) {
+  if (!_seize)
+    return super::attach(pid);
+
+  CHK(seize(pid));
+
+  if (wrapPtrace(PTRACE_INTERRUPT, pid, nullptr, nullptr) < 0)
+    return Platform::TranslateError();
+
+  return kSuccess;
+}
+
+ErrorCode PTrace::seize(ProcessId pid) {
+  if (pid <= kAnyProcessId)
+    return kErrorProcessNotFound;
+
+  DS2LOG(Debug, "seizing pid %" PRIu64, (uint64_t)pid);
+
+  ErrorCode error = kSuccess;
+  if (wrapPtrace(PTRACE_SEIZE, pid, nullptr, traceOptions()) < 0) {
+    error = Platform::TranslateError();
+  } else if (_seizeGate[1] >= 0) {
+    // Let the child we spawned go ahead with exec.
+    char c = 0;
+    if (::write(_seizeGate[1], &c, 1) != 1) {
+      error = Platform::TranslateError();
+    }
+  }
+
+  closeSeizeGate();
+  return error;
+}
+
+unsigned long PTrace::traceOptions() const {
+  unsigned long options = PTRACE_O_TRACECLONE;
+
+  // A seized tracee doesn't get a SIGTRAP after exec.
+  if (_seize) {
+    options |= PTRACE_O_TRACEEXEC;
+  }
+
+  return options;
+}
+
+void PTrace::closeSeizeGate() {
+  for (int &fd : _seizeGate) {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+}
+
 ErrorCode PTrace::kill(ProcessThreadId const &ptid, int signal) {
   if (!ptid.valid())
     return kErrorInvalidArgument;
@@ -92,6 +185,36 @@ ErrorCode PTrace::kill(ProcessThreadId const &ptid, int signal) {
   return kSuccess;
 }
 
+ErrorCode PTrace::suspend(ProcessThreadId const &ptid) {
+  if (!_seize)
+    return super::suspend(ptid);
+
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  if (wrapPtrace(PTRACE_INTERRUPT, pid, nullptr, nullptr) < 0)
+    return Platform::TranslateError();
+
+  return kSuccess;
+}
+
+//
+// Lets a seized tracee in a group-stop go, but leaves it stopped until it
+// gets a SIGCONT, as it would be without us; it then reports a
+// PTRACE_EVENT_STOP. PTRACE_INTERRUPT can still stop it in the meantime.
+//
+ErrorCode PTrace::listen(ProcessThreadId const &ptid) {
+  DS2ASSERT(_seize);
+
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  if (wrapPtrace(PTRACE_LISTEN, pid, nullptr, nullptr) < 0)
+    return Platform::TranslateError();
+
+  return kSuccess;
+}
+
 ErrorCode PTrace::readBytes(ProcessThreadId const &ptid, Address const &address,
                             void *buffer, size_t length, size_t *count,
                             bool nullTerm) {
@@ -224,19 +347,32 @@ ErrorCode PTrace::writeMemory(ProcessThreadId const &ptid,
   return kSuccess;
 }
 
+ErrorCode PTrace::readCPUState(ProcessThreadId const &ptid,
+                               ProcessInfo const &pinfo,
+                               Architecture::CPUState &state) {
+  return readCPUStateSets(ptid, pinfo, state, Architecture::kRegisterSetAll);
+}
+
+ErrorCode PTrace::writeCPUState(ProcessThreadId const &ptid,
+                                ProcessInfo const &pinfo,
+                                Architecture::CPUState const &state) {
+  return writeCPUStateSets(ptid, pinfo, state, Architecture::kRegisterSetAll);
+}
+
 ErrorCode PTrace::prepareAddressForResume(ProcessThreadId const &ptid,
                                           ProcessInfo const &pinfo,
                                           Address const &address) {
   if (address.valid()) {
     Architecture::CPUState state;
-    ErrorCode error = readCPUState(ptid, pinfo, state);
+    ErrorCode error =
+        readCPUStateSets(ptid, pinfo, state, Architecture::kRegisterSetGP);
     if (error != kSuccess) {
       return error;
     }
 
     state.setPC(address);
 
-    error = writeCPUState(ptid, pinfo, state);
+    error = writeCPUStateSets(ptid, pinfo, state, Architecture::kRegisterSetGP);
     if (error != kSuccess) {
       return error;
     }
@@ -0,0 +1,311 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+#include "DebugServer2/Host/Linux/SharedMemoryChannel.h"
+#include "DebugServer2/Host/Linux/ExtraWrappers.h"
+#include "DebugServer2/Utils/Log.h"
+#include "DebugServer2/Utils/Stringify.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using ds2::Utils::Stringify;
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+static_assert((SharedMemoryChannel::kRingSize &
+               (SharedMemoryChannel::kRingSize - 1)) == 0,
+              "ring size must be a power of two");
+static_assert(sizeof(SharedMemoryChannel::Header) <=
+                  SharedMemoryChannel::kDataOffset,
+              "header does not fit before the rings");
+
+SharedMemoryChannel::SharedMemoryChannel(std::unique_ptr<Socket> socket)
+    : _socket(std::move(socket)), _closed(false), _header(nullptr),
+      _mapSize(0), _events{{-1, -1}, {-1, -1}}, _input(nullptr),
+      _output(nullptr), _inputData(nullptr), _outputData(nullptr) {}
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+  close();
+
+  if (_header != nullptr) {
+    ::munmap(_header, _mapSize);
+  }
+  for (auto &ring : _events) {
+    for (int fd : ring) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+    }
+  }
+}
+
+std::unique_ptr<SharedMemoryChannel>
+SharedMemoryChannel::Create(std::unique_ptr<Socket> socket) {
+  if (!socket || !socket->connected()) {
+    return nullptr;
+  }
+
+  auto channel = make_protected_unique(std::move(socket));
+  if (!channel->initialize()) {
+    return nullptr;
+  }
+
+  return channel;
+}
+
+bool SharedMemoryChannel::initialize() {
+  _mapSize = kDataOffset + 2 * static_cast<size_t>(kRingSize);
+
+  int memFd = ::syscall(SYS_memfd_create, "ds2-channel", MFD_CLOEXEC);
+  if (memFd < 0) {
+    DS2LOG(Error, "unable to create shared memory: %s",
+           Stringify::Errno(errno));
+    return false;
+  }
+
+  if (::ftruncate(memFd, _mapSize) < 0) {
+    DS2LOG(Error, "unable to size shared memory: %s", Stringify::Errno(errno));
+    ::close(memFd);
+    return false;
+  }
+
+  void *base =
+      ::mmap(nullptr, _mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+  if (base == MAP_FAILED) {
+    DS2LOG(Error, "unable to map shared memory: %s", Stringify::Errno(errno));
+    ::close(memFd);
+    return false;
+  }
+
+  _header = new (base) Header();
+  _header->magic = kMagic;
+  _header->version = kVersion;
+  _header->ringSize = kRingSize;
+  _header->dataOffset = kDataOffset;
+
+  _input = &_header->rings[kClientToServer];
+  _output = &_header->rings[kServerToClient];
+  _inputData = static_cast<uint8_t *>(base) + kDataOffset;
+  _outputData = _inputData + kRingSize;
+
+  int fds[5] = {memFd};
+  for (size_t n = 0; n < 4; n++) {
+    int &event = _events[n / 2][n % 2];
+    event = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event < 0) {
+      DS2LOG(Error, "unable to create eventfd: %s", Stringify::Errno(errno));
+      ::close(memFd);
+      return false;
+    }
+    fds[n + 1] = event;
+  }
+
+  bool success = _socket->sendDescriptors(fds, 5);
+  ::close(memFd);
+
+  if (!success) {
+    DS2LOG(Error, "unable to pass shared memory to the client: %s",
+           _socket->error().c_str());
+    return false;
+  }
+
+  DS2LOG(Debug, "shared memory channel ready, %u bytes per ring", kRingSize);
+  return true;
+}
+
+void SharedMemoryChannel::close() {
+  if (_socket && !_closed.exchange(true)) {
+    ::shutdown(_socket->handle(), SHUT_RDWR);
+  }
+}
+
+bool SharedMemoryChannel::connected() const {
+  return !_closed && _socket && _socket->connected();
+}
+
+//
+// Blocks until the other side signals `event', the socket hangs up, or `ms'
+// expires. `flag' is the waiting flag the caller has already set and
+// re-checked the ring after. Returns false if the peer went away.
+//
+bool SharedMemoryChannel::sleep(int event, std::atomic<uint32_t> &flag,
+                                int ms) {
+  struct pollfd pfds[2];
+  pfds[0].fd = event;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = _socket->handle();
+  pfds[1].events = POLLIN;
+
+  int nfds;
+  do {
+    pfds[0].revents = pfds[1].revents = 0;
+    nfds = ::poll(pfds, 2, ms);
+  } while (nfds < 0 && errno == EINTR);
+
+  flag.store(0);
+
+  if (pfds[0].revents & POLLIN) {
+    eventfd_t value;
+    ::eventfd_read(event, &value);
+  }
+
+  //
+  // The client never writes to the socket after the handshake, so anything
+  // happening there means it is gone.
+  //
+  if (nfds < 0 || pfds[1].revents != 0) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+//
+// The positions live in memory the client can write to. A ring never holds
+// more than kRingSize bytes; if it seems to, the client is broken or hostile,
+// and using the positions would take us out of the mapping. End the session.
+//
+bool SharedMemoryChannel::checkPositions(uint32_t readPos, uint32_t writePos) {
+  if (writePos - readPos <= kRingSize)
+    return true;
+
+  DS2LOG(Error, "corrupted shared memory ring, readPos=%u writePos=%u",
+         readPos, writePos);
+  close();
+  return false;
+}
+
+void SharedMemoryChannel::signal(int event,
+                                 std::atomic<uint32_t> const &flag) {
+  if (flag.load() != 0) {
+    ::eventfd_write(event, 1);
+  }
+}
+
+bool SharedMemoryChannel::wait(int ms) {
+  while (connected()) {
+    if (_input->writePos.load(std::memory_order_acquire) !=
+        _input->readPos.load(std::memory_order_relaxed))
+      return true;
+
+    _input->readerWaiting.store(1);
+    if (_input->writePos.load() !=
+        _input->readPos.load(std::memory_order_relaxed)) {
+      _input->readerWaiting.store(0);
+      return true;
+    }
+
+    if (!sleep(_events[kClientToServer][kEventProduced],
+               _input->readerWaiting, ms))
+      return false;
+
+    if (ms >= 0) {
+      return _input->writePos.load(std::memory_order_acquire) !=
+             _input->readPos.load(std::memory_order_relaxed);
+    }
+  }
+
+  return false;
+}
+
+ssize_t SharedMemoryChannel::receive(void *buffer, size_t length) {
+  if (!connected()) {
+    return -1;
+  }
+
+  uint32_t readPos = _input->readPos.load(std::memory_order_relaxed);
+  uint32_t writePos = _input->writePos.load(std::memory_order_acquire);
+  if (!checkPositions(readPos, writePos)) {
+    return -1;
+  }
+
+  size_t count = std::min<size_t>(length, writePos - readPos);
+  if (count == 0) {
+    return 0;
+  }
+
+  size_t offset = readPos & (kRingSize - 1);
+  size_t first = std::min<size_t>(count, kRingSize - offset);
+  std::memcpy(buffer, _inputData + offset, first);
+  std::memcpy(static_cast<uint8_t *>(buffer) + first, _inputData,
+              count - first);
+
+  _input->readPos.store(readPos + count);
+  signal(_events[kClientToServer][kEventConsumed], _input->writerWaiting);
+  return count;
+}
+
+ssize_t SharedMemoryChannel::send(void const *buffer, size_t length) {
+  Buffer buf = {buffer, length};
+  return sendv(&buf, 1) ? static_cast<ssize_t>(length) : -1;
+}
+
+//
+// The buffers are copied straight into the ring, which is the only copy the
+// data goes through on its way to the client.
+//
+bool SharedMemoryChannel::sendv(Buffer const *buffers, size_t count) {
+  std::lock_guard<std::mutex> guard(_sendLock);
+
+  for (size_t n = 0; n < count; n++) {
+    uint8_t const *data = static_cast<uint8_t const *>(buffers[n].data);
+    size_t length = buffers[n].length;
+
+    while (length > 0) {
+      if (!connected()) {
+        return false;
+      }
+
+      uint32_t writePos = _output->writePos.load(std::memory_order_relaxed);
+      uint32_t readPos = _output->readPos.load(std::memory_order_acquire);
+      if (!checkPositions(readPos, writePos)) {
+        return false;
+      }
+
+      size_t space = kRingSize - (writePos - readPos);
+
+      if (space == 0) {
+        _output->writerWaiting.store(1);
+        if (_output->readPos.load() == readPos) {
+          if (!sleep(_events[kServerToClient][kEventConsumed],
+                     _output->writerWaiting, -1))
+            return false;
+        } else {
+          _output->writerWaiting.store(0);
+        }
+        continue;
+      }
+
+      size_t chunk = std::min(length, space);
+      size_t offset = writePos & (kRingSize - 1);
+      size_t first = std::min<size_t>(chunk, kRingSize - offset);
+      std::memcpy(_outputData + offset, data, first);
+      std::memcpy(_outputData, data + first, chunk - first);
+
+      _output->writePos.store(writePos + chunk);
+      signal(_events[kServerToClient][kEventProduced], _output->readerWaiting);
+
+      data += chunk;
+      length -= chunk;
+    }
+  }
+
+  return true;
+}
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
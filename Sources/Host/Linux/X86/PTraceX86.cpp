@@ -125,103 +125,121 @@ state32_to_user(struct xsave_struct &xfpregs,
   }
 }
 
-ErrorCode PTrace::readCPUState(ProcessThreadId const &ptid, ProcessInfo const &,
-                               Architecture::CPUState &state) {
+ErrorCode PTrace::readCPUStateSets(ProcessThreadId const &ptid,
+                                   ProcessInfo const &,
+                                   Architecture::CPUState &state,
+                                   uint32_t sets) {
   pid_t pid;
   CHK(ptidToPid(ptid, pid));
 
   //
   // Read GPRs
   //
-  user_regs_struct gprs;
-  if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
-    return Platform::TranslateError();
+  if (sets & Architecture::kRegisterSetGP) {
+    user_regs_struct gprs;
+    if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
+      return Platform::TranslateError();
 
-  Architecture::X86::user_to_state32(state, gprs);
+    Architecture::X86::user_to_state32(state, gprs);
+    state.populatedSets |= Architecture::kRegisterSetGP;
+  }
 
   //
   // Read xregs (x87, mmx, sse, avx)
   //
-  struct xsave_struct xfpregs;
-  struct iovec fpregs_iovec;
-  fpregs_iovec.iov_base = &xfpregs;
-  fpregs_iovec.iov_len = sizeof(xfpregs);
-
-  // TODO: If this fails (i.e. ptrace returns < 0), it means XSAVE is most
-  // likely unsupported and we can't expect XSAVE to work. In this case, we
-  // should fallback to FXSAVE and only read the legacy portion of our xsave
-  // state (x87, MMX, SSE).
-  // If this call fails, don't return failure, since AVX may not be available
-  // on this CPU.
-  if (wrapPtrace(PTRACE_GETREGSET, pid, NT_X86_XSTATE, &fpregs_iovec) == 0) {
-    user_to_state32(state, xfpregs);
+  if (sets & Architecture::kRegisterSetFP) {
+    struct xsave_struct xfpregs;
+    struct iovec fpregs_iovec;
+    fpregs_iovec.iov_base = &xfpregs;
+    fpregs_iovec.iov_len = sizeof(xfpregs);
+
+    // TODO: If this fails (i.e. ptrace returns < 0), it means XSAVE is most
+    // likely unsupported and we can't expect XSAVE to work. In this case, we
+    // should fallback to FXSAVE and only read the legacy portion of our xsave
+    // state (x87, MMX, SSE).
+    // If this call fails, don't return failure, since AVX may not be available
+    // on this CPU.
+    if (wrapPtrace(PTRACE_GETREGSET, pid, NT_X86_XSTATE, &fpregs_iovec) == 0) {
+      user_to_state32(state, xfpregs);
+    }
+    state.populatedSets |= Architecture::kRegisterSetFP;
   }
 
   // Read the debug registers
-  size_t debugRegOffset = offsetof(struct user, u_debugreg);
-  size_t debugRegSize = sizeof(((struct user *)nullptr)->u_debugreg[0]);
-  for (size_t i = 0; i < array_sizeof(state.dr.dr); ++i) {
-    // dr4 and dr5 are reserved and not used
-    if (i == 4 || i == 5) {
-      continue;
-    }
-
-    errno = 0;
-    long val = wrapPtrace(PTRACE_PEEKUSER, pid,
-                          debugRegOffset + i * debugRegSize, nullptr);
-    if (errno != 0) {
-      return Platform::TranslateError();
+  if (sets & Architecture::kRegisterSetDebug) {
+    size_t debugRegOffset = offsetof(struct user, u_debugreg);
+    size_t debugRegSize = sizeof(((struct user *)nullptr)->u_debugreg[0]);
+    for (size_t i = 0; i < array_sizeof(state.dr.dr); ++i) {
+      // dr4 and dr5 are reserved and not used
+      if (i == 4 || i == 5) {
+        continue;
+      }
+
+      errno = 0;
+      long val = wrapPtrace(PTRACE_PEEKUSER, pid,
+                            debugRegOffset + i * debugRegSize, nullptr);
+      if (errno != 0) {
+        return Platform::TranslateError();
+      }
+
+      state.dr.dr[i] = val;
     }
-
-    state.dr.dr[i] = val;
+    state.populatedSets |= Architecture::kRegisterSetDebug;
   }
 
   return kSuccess;
 }
 
-ErrorCode PTrace::writeCPUState(ProcessThreadId const &ptid,
-                                ProcessInfo const &,
-                                Architecture::CPUState const &state) {
+ErrorCode PTrace::writeCPUStateSets(ProcessThreadId const &ptid,
+                                    ProcessInfo const &,
+                                    Architecture::CPUState const &state,
+                                    uint32_t sets) {
   pid_t pid;
   CHK(ptidToPid(ptid, pid));
 
   //
   // Write GPRs
   //
-  user_regs_struct gprs;
-  Architecture::X86::state32_to_user(gprs, state);
+  if (sets & Architecture::kRegisterSetGP) {
+    user_regs_struct gprs;
+    Architecture::X86::state32_to_user(gprs, state);
 
-  if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
-    return Platform::TranslateError();
+    if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
+      return Platform::TranslateError();
+  }
 
   //
   // Write xregs (x87, mmx, sse, avx)
   //
-  struct xsave_struct xfpregs;
-  struct iovec fpregs_iovec;
-  fpregs_iovec.iov_base = &xfpregs;
-  fpregs_iovec.iov_len = sizeof(xfpregs);
-
-  state32_to_user(xfpregs, state);
-
-  // TODO: If this fails (i.e. ptrace returns < 0), it means XSAVE is most
-  // likely unsupported and we can't expect XSAVE to work. In this case, we
-  // should fallback to FXSAVE and only write the legacy portion of our xsave
-  // state (x87, MMX, SSE)
-  wrapPtrace(PTRACE_SETREGSET, pid, NT_X86_XSTATE, &fpregs_iovec);
+  if (sets & Architecture::kRegisterSetFP) {
+    struct xsave_struct xfpregs;
+    struct iovec fpregs_iovec;
+    fpregs_iovec.iov_base = &xfpregs;
+    fpregs_iovec.iov_len = sizeof(xfpregs);
+
+    state32_to_user(xfpregs, state);
+
+    // TODO: If this fails (i.e. ptrace returns < 0), it means XSAVE is most
+    // likely unsupported and we can't expect XSAVE to work. In this case, we
+    // should fallback to FXSAVE and only write the legacy portion of our xsave
+    // state (x87, MMX, SSE)
+    wrapPtrace(PTRACE_SETREGSET, pid, NT_X86_XSTATE, &fpregs_iovec);
+  }
 
   // Write the debug registers
-  size_t debugRegOffset = offsetof(struct user, u_debugreg);
-  size_t debugRegSize = sizeof(((struct user *)nullptr)->u_debugreg[0]);
-  for (size_t i = 0; i < array_sizeof(state.dr.dr); ++i) {
-    // dr4 and dr5 are reserved and not used
-    if (i == 4 || i == 5) {
-      continue;
-    }
-
-    if (wrapPtrace(PTRACE_POKEUSER, pid, debugRegOffset + i * debugRegSize,
-                   state.dr.dr[i]) < 0) {
-      return Platform::TranslateError();
+  if (sets & Architecture::kRegisterSetDebug) {
+    size_t debugRegOffset = offsetof(struct user, u_debugreg);
+    size_t debugRegSize = sizeof(((struct user *)nullptr)->u_debugreg[0]);
+    for (size_t i = 0; i < array_sizeof(state.dr.dr); ++i) {
+      // dr4 and dr5 are reserved and not used
+      if (i == 4 || i == 5) {
+        continue;
+      }
+
+      if (wrapPtrace(PTRACE_POKEUSER, pid, debugRegOffset + i * debugRegSize,
+                     state.dr.dr[i]) < 0) {
+        return Platform::TranslateError();
+      }
     }
   }
 
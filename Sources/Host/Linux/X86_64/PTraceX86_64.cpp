@@ -239,78 +239,89 @@ state64_to_user(struct xsave_struct &xfpregs,
   }
 }
 
-ErrorCode PTrace::readCPUState(ProcessThreadId const &ptid,
-                               ProcessInfo const &pinfo,
-                               Architecture::CPUState &state) {
+ErrorCode PTrace::readCPUStateSets(ProcessThreadId const &ptid,
+                                   ProcessInfo const &pinfo,
+                                   Architecture::CPUState &state,
+                                   uint32_t sets) {
   pid_t pid;
   CHK(ptidToPid(ptid, pid));
 
+  state.is32 = (pinfo.pointerSize == sizeof(uint32_t));
+
   //
   // Read GPRs
   //
-  user_regs_struct gprs;
-  if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
-    return Platform::TranslateError();
-
-  if (pinfo.pointerSize == sizeof(uint32_t)) {
-    state.is32 = true;
-    Architecture::X86::user_to_state32(state.state32, gprs);
-  } else {
-    state.is32 = false;
-    Architecture::X86::user_to_state64(state.state64, gprs);
+  if (sets & Architecture::kRegisterSetGP) {
+    user_regs_struct gprs;
+    if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
+      return Platform::TranslateError();
+
+    if (state.is32) {
+      Architecture::X86::user_to_state32(state.state32, gprs);
+    } else {
+      Architecture::X86::user_to_state64(state.state64, gprs);
+    }
+    state.populatedSets |= Architecture::kRegisterSetGP;
   }
 
   //
   // Read SSE and AVX
   //
-  struct xsave_struct xfpregs;
-  struct iovec fpregs_iovec;
-  fpregs_iovec.iov_base = &xfpregs;
-  fpregs_iovec.iov_len = sizeof(xfpregs);
-
-  // TODO: If this fails (i.e. ptrace returns < 0), it means XSAVE is most
-  // likely unsupported and we can't expect XSAVE to work. In this case, we
-  // should fallback to FXSAVE and only read the legacy portion of our xsave
-  // state (x87, MMX, SSE).
-  // If this call fails, don't return failure, since AVX may not be available
-  // on this CPU.
-  if (wrapPtrace(PTRACE_GETREGSET, pid, NT_X86_XSTATE, &fpregs_iovec) == 0) {
-    if (pinfo.pointerSize == sizeof(uint32_t)) {
-      user_to_state32(state.state32, xfpregs);
-    } else {
-      user_to_state64(state.state64, xfpregs);
+  if (sets & Architecture::kRegisterSetFP) {
+    struct xsave_struct xfpregs;
+    struct iovec fpregs_iovec;
+    fpregs_iovec.iov_base = &xfpregs;
+    fpregs_iovec.iov_len = sizeof(xfpregs);
+
+    // TODO: If this fails (i.e. ptrace returns < 0), it means XSAVE is most
+    // likely unsupported and we can't expect XSAVE to work. In this case, we
+    // should fallback to FXSAVE and only read the legacy portion of our xsave
+    // state (x87, MMX, SSE).
+    // If this call fails, don't return failure, since AVX may not be available
+    // on this CPU.
+    if (wrapPtrace(PTRACE_GETREGSET, pid, NT_X86_XSTATE, &fpregs_iovec) == 0) {
+      if (state.is32) {
+        user_to_state32(state.state32, xfpregs);
+      } else {
+        user_to_state64(state.state64, xfpregs);
+      }
     }
+    state.populatedSets |= Architecture::kRegisterSetFP;
   }
 
   // Read the debug registers
-  size_t debugRegOffset = offsetof(struct user, u_debugreg);
-  size_t debugRegSize = sizeof(((struct user *)0)->u_debugreg[0]);
-  for (size_t i = 0; i < array_sizeof(state.state64.dr.dr); ++i) {
-    // dr4 and dr5 are reserved and not used
-    if (i == 4 || i == 5) {
-      continue;
-    }
-
-    errno = 0;
-    long val = wrapPtrace(PTRACE_PEEKUSER, pid,
-                          debugRegOffset + i * debugRegSize, nullptr);
-    if (errno != 0) {
-      return Platform::TranslateError();
-    }
-
-    if (state.is32) {
-      state.state32.dr.dr[i] = val;
-    } else {
-      state.state64.dr.dr[i] = val;
+  if (sets & Architecture::kRegisterSetDebug) {
+    size_t debugRegOffset = offsetof(struct user, u_debugreg);
+    size_t debugRegSize = sizeof(((struct user *)0)->u_debugreg[0]);
+    for (size_t i = 0; i < array_sizeof(state.state64.dr.dr); ++i) {
+      // dr4 and dr5 are reserved and not used
+      if (i == 4 || i == 5) {
+        continue;
+      }
+
+      errno = 0;
+      long val = wrapPtrace(PTRACE_PEEKUSER, pid,
+                            debugRegOffset + i * debugRegSize, nullptr);
+      if (errno != 0) {
+        return Platform::TranslateError();
+      }
+
+      if (state.is32) {
+        state.state32.dr.dr[i] = val;
+      } else {
+        state.state64.dr.dr[i] = val;
+      }
     }
+    state.populatedSets |= Architecture::kRegisterSetDebug;
   }
 
   return kSuccess;
 }
 
-ErrorCode PTrace::writeCPUState(ProcessThreadId const &ptid,
-                                ProcessInfo const &pinfo,
-                                Architecture::CPUState const &state) {
+ErrorCode PTrace::writeCPUStateSets(ProcessThreadId const &ptid,
+                                    ProcessInfo const &pinfo,
+                                    Architecture::CPUState const &state,
+                                    uint32_t sets) {
   pid_t pid;
   CHK(ptidToPid(ptid, pid));
 
@@ -322,49 +333,55 @@ ErrorCode PTrace::writeCPUState(ProcessThreadId const &ptid,
   //
   // Write GPRs
   //
-  user_regs_struct gprs;
-  if (state.is32) {
-    Architecture::X86::state32_to_user(gprs, state.state32);
-  } else {
-    Architecture::X86::state64_to_user(gprs, state.state64);
-  }
+  if (sets & Architecture::kRegisterSetGP) {
+    user_regs_struct gprs;
+    if (state.is32) {
+      Architecture::X86::state32_to_user(gprs, state.state32);
+    } else {
+      Architecture::X86::state64_to_user(gprs, state.state64);
+    }
 
-  if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
-    return Platform::TranslateError();
+    if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
+      return Platform::TranslateError();
+  }
 
   //
   // Write SSE and AVX
   //
-  struct xsave_struct xfpregs;
-  struct iovec fpregs_iovec;
-  fpregs_iovec.iov_base = &xfpregs;
-  fpregs_iovec.iov_len = sizeof(xfpregs);
-
-  if (state.is32) {
-    state32_to_user(xfpregs, state.state32);
-  } else {
-    state64_to_user(xfpregs, state.state64);
-  }
-
-  // TODO: If this fails (i.e. ptrace returns < 0), it means XSAVE is most
-  // likely unsupported and we can't expect XSAVE to work. In this case, we
-  // should fallback to FXSAVE and only write the legacy portion of our xsave
-  // state (x87, MMX, SSE).
-  wrapPtrace(PTRACE_SETREGSET, pid, NT_X86_XSTATE, &fpregs_iovec);
+  if (sets & Architecture::kRegisterSetFP) {
+    struct xsave_struct xfpregs;
+    struct iovec fpregs_iovec;
+    fpregs_iovec.iov_base = &xfpregs;
+    fpregs_iovec.iov_len = sizeof(xfpregs);
 
-  // Write the debug registers
-  size_t debugRegOffset = offsetof(struct user, u_debugreg);
-  size_t debugRegSize = sizeof(((struct user *)0)->u_debugreg[0]);
-  for (size_t i = 0; i < array_sizeof(state.state64.dr.dr); ++i) {
-    // dr4 and dr5 are reserved and not used
-    if (i == 4 || i == 5) {
-      continue;
+    if (state.is32) {
+      state32_to_user(xfpregs, state.state32);
+    } else {
+      state64_to_user(xfpregs, state.state64);
     }
 
-    if (wrapPtrace(PTRACE_POKEUSER, pid, debugRegOffset + i * debugRegSize,
-                   state.is32 ? state.state32.dr.dr[i]
-                              : state.state64.dr.dr[i]) < 0) {
-      return Platform::TranslateError();
+    // TODO: If this fails (i.e. ptrace returns < 0), it means XSAVE is most
+    // likely unsupported and we can't expect XSAVE to work. In this case, we
+    // should fallback to FXSAVE and only write the legacy portion of our xsave
+    // state (x87, MMX, SSE).
+    wrapPtrace(PTRACE_SETREGSET, pid, NT_X86_XSTATE, &fpregs_iovec);
+  }
+
+  // Write the debug registers
+  if (sets & Architecture::kRegisterSetDebug) {
+    size_t debugRegOffset = offsetof(struct user, u_debugreg);
+    size_t debugRegSize = sizeof(((struct user *)0)->u_debugreg[0]);
+    for (size_t i = 0; i < array_sizeof(state.state64.dr.dr); ++i) {
+      // dr4 and dr5 are reserved and not used
+      if (i == 4 || i == 5) {
+        continue;
+      }
+
+      if (wrapPtrace(PTRACE_POKEUSER, pid, debugRegOffset + i * debugRegSize,
+                     state.is32 ? state.state32.dr.dr[i]
+                                : state.state64.dr.dr[i]) < 0) {
+        return Platform::TranslateError();
+      }
     }
   }
 
@@ -185,6 +185,21 @@ fail:
   return error;
 }
 
+ErrorCode PTrace::readCPUStateSets(ProcessThreadId const &ptid,
+                                   ProcessInfo const &info,
+                                   Architecture::CPUState &state, uint32_t) {
+  CHK(readCPUState(ptid, info, state));
+  state.populatedSets = Architecture::kRegisterSetAll;
+  return kSuccess;
+}
+
+ErrorCode PTrace::writeCPUStateSets(ProcessThreadId const &ptid,
+                                    ProcessInfo const &info,
+                                    Architecture::CPUState const &state,
+                                    uint32_t) {
+  return writeCPUState(ptid, info, state);
+}
+
 ErrorCode PTrace::ptidToPid(ProcessThreadId const &ptid, pid_t &pid) {
   if (!ptid.valid())
     return kErrorInvalidArgument;
@@ -10,6 +10,7 @@
 
 #include <cerrno>
 #include <climits>
+#include <csignal>
 #include <cstring>
 #include <fcntl.h>
 #include <grp.h>
@@ -29,7 +30,17 @@ namespace ds2 {
 namespace Host {
 
 void Platform::Initialize() {
-  // Nothing to do here.
+#if defined(OS_LINUX)
+  //
+  // Inferior state changes are consumed through a signalfd in the process
+  // event loop, which requires SIGCHLD to be blocked in every thread. Do it
+  // here, before any thread is started, so that they all inherit the mask.
+  //
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  ::pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+#endif
 }
 
 size_t Platform::GetPageSize() {
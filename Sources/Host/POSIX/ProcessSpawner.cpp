@@ -15,6 +15,7 @@
 
 #include <cerrno>
 #include <climits>
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
@@ -71,7 +72,8 @@ static inline void close_terminal(int fds[2]) {
 }
 
 ProcessSpawner::ProcessSpawner()
-    : _exitStatus(0), _signalCode(0), _pid(0), _shell(false) {}
+    : _exitStatus(0), _signalCode(0), _pid(0), _shell(false),
+      _manualRedirection(false) {}
 
 ProcessSpawner::~ProcessSpawner() { flushAndExit(); }
 
@@ -386,9 +388,10 @@ ErrorCode ProcessSpawner::run(std::function<bool()> preExecAction) {
 
     case kRedirectBuffer:
       _outputBuffer.clear();
+      startRedirectThread = true;
     // fall-through
     case kRedirectDelegate:
-      startRedirectThread = true;
+      startRedirectThread = startRedirectThread || !_manualRedirection;
     // fall-through
     case kRedirectTerminal:
       if (term[RD] == -1) {
@@ -411,6 +414,15 @@ ErrorCode ProcessSpawner::run(std::function<bool()> preExecAction) {
   }
 
   if (_pid == 0) {
+    //
+    // We may be blocking signals we want to consume synchronously (e.g.
+    // SIGCHLD through a signalfd); don't let the inferior inherit that.
+    //
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    ::sigprocmask(SIG_UNBLOCK, &mask, nullptr);
+
     if (::setgid(::getgid()) == 0) {
       ::setsid();
 
@@ -549,7 +561,9 @@ ErrorCode ProcessSpawner::wait() {
   //
   // Wait also the termination of the thread.
   //
-  _delegateThread.join();
+  if (_delegateThread.joinable()) {
+    _delegateThread.join();
+  }
 
   _pid = 0;
   if (WIFEXITED(status)) {
@@ -596,7 +610,7 @@ void ProcessSpawner::redirectionThread() {
       }
     }
 
-    nfds = ::poll(pfds, nfds, 100);
+    nfds = ::poll(pfds, nfds, -1);
     if (nfds < 0)
       break;
 
@@ -620,7 +634,7 @@ void ProcessSpawner::redirectionThread() {
 
       if (pfds[n].events & POLLIN) {
         if (pfds[n].revents & POLLIN) {
-          char buf[128];
+          char buf[4096];
           ssize_t nread = ::read(pfds[n].fd, buf, sizeof(buf));
           if (nread > 0) {
             if (descriptor->mode == kRedirectBuffer) {
@@ -638,6 +652,10 @@ void ProcessSpawner::redirectionThread() {
       break;
   }
 
+  closeRedirection();
+}
+
+void ProcessSpawner::closeRedirection() {
   for (auto &_descriptor : _descriptors) {
     if (_descriptor.fd != -1) {
       ::close(_descriptor.fd);
@@ -645,5 +663,64 @@ void ProcessSpawner::redirectionThread() {
     }
   }
 }
+
+//
+// Manual redirection
+//
+int ProcessSpawner::redirectionFd() const {
+  if (!_manualRedirection || _pid == 0 || _delegateThread.joinable())
+    return -1;
+
+  for (size_t n = 1; n < 3; n++) {
+    if (_descriptors[n].mode == kRedirectDelegate)
+      return _descriptors[n].fd;
+  }
+  return -1;
+}
+
+bool ProcessSpawner::pumpRedirection() {
+  int fd = redirectionFd();
+  if (fd < 0)
+    return false;
+
+  //
+  // stdout and stderr share the same terminal, so whatever we read goes to
+  // the first delegate.
+  //
+  RedirectDescriptor &descriptor =
+      (_descriptors[1].mode == kRedirectDelegate) ? _descriptors[1]
+                                                  : _descriptors[2];
+
+  for (;;) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int nfds = ::poll(&pfd, 1, 0);
+    if (nfds < 0 && errno == EINTR)
+      continue;
+    if (nfds <= 0)
+      return true;
+
+    if (pfd.revents & POLLIN) {
+      char buf[4096];
+      ssize_t nread = ::read(fd, buf, sizeof(buf));
+      if (nread > 0) {
+        descriptor.delegate(buf, nread);
+        continue;
+      }
+    } else if (!(pfd.revents & (POLLHUP | POLLERR))) {
+      return true;
+    }
+
+    //
+    // The inferior closed its end of the terminal (reading a terminal whose
+    // other end is gone fails with EIO rather than returning 0).
+    //
+    closeRedirection();
+    return false;
+  }
+}
 } // namespace Host
 } // namespace ds2
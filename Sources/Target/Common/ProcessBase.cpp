@@ -7,12 +7,17 @@
 #include "DebugServer2/Target/ProcessBase.h"
 #include "DebugServer2/Architecture/CPUState.h"
 #include "DebugServer2/Core/SoftwareBreakpointManager.h"
+#include "DebugServer2/Host/Platform.h"
 #include "DebugServer2/Target/Thread.h"
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/Stringify.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <list>
 
+using ds2::Host::Platform;
 using ds2::Utils::Stringify;
 
 namespace ds2 {
@@ -20,7 +25,8 @@ namespace Target {
 
 ProcessBase::ProcessBase()
     : _terminated(false), _flags(0), _pid(kAnyProcessId), _loadBase(),
-      _entryPoint(), _currentThread(nullptr) {}
+      _entryPoint(), _currentThread(nullptr), _memoryCacheHits(0),
+      _memoryCacheMisses(0) {}
 
 ProcessBase::~ProcessBase() {
   for (auto thread : _threads) {
@@ -50,6 +56,7 @@ void ProcessBase::cleanup() {
   }
   _threads.clear();
   _currentThread = nullptr;
+  invalidateMemoryCache();
 }
 
 ErrorCode ProcessBase::initialize(ProcessId pid, uint32_t flags) {
@@ -105,7 +112,7 @@ ErrorCode ProcessBase::suspend() {
                "tried to suspended tid %" PRI_PID " which is already dead",
                thread->tid());
         removeThread(thread->tid());
-        return error;
+        break;
 
       default:
         DS2LOG(Warning, "failed suspending tid %" PRI_PID ", error=%s",
@@ -139,7 +146,7 @@ ErrorCode ProcessBase::resume(int signal, std::set<Thread *> const &excluded) {
     case Thread::kStopped:
     case Thread::kStepped: {
       Architecture::CPUState state;
-      thread->readCPUState(state);
+      thread->readCPUStateSets(state, Architecture::kRegisterSetGP);
       DS2LOG(Debug,
              "resuming tid %" PRI_PID " in state %s from pc %" PRI_PTR
              " with signal %d",
@@ -204,6 +211,11 @@ ErrorCode ProcessBase::enumerateMappedFiles(
   });
 }
 
+ErrorCode ProcessBase::enumerateMemoryRegions(
+    std::function<void(MemoryRegionInfo const &)> const &) {
+  return kErrorUnsupported;
+}
+
 ErrorCode ProcessBase::readMemoryBuffer(Address const &address, size_t length,
                                         ByteVector &buffer) {
   if (_pid == kAnyProcessId)
@@ -211,28 +223,193 @@ ErrorCode ProcessBase::readMemoryBuffer(Address const &address, size_t length,
   else if (!address.valid())
     return kErrorInvalidArgument;
 
-  buffer.resize(length);
+  size_t nread = length;
+  if (length == 0 ||
+      readMemoryCached(address.value(), length, buffer) != kSuccess) {
+    //
+    // Reads that touch unreadable pages (or too many pages) bypass the cache
+    // so that we still return the part of the range that could be read.
+    //
+    buffer.resize(length);
+
+    ErrorCode error = readMemory(address, buffer.data(), length, &nread);
+    if (error != kSuccess) {
+      buffer.clear();
+      return error;
+    }
 
-  size_t nread;
-  ErrorCode error = readMemory(address, buffer.data(), length, &nread);
-  if (error != kSuccess) {
-    buffer.clear();
-    return error;
+    buffer.resize(nread);
+  }
+
+  if (_softwareBreakpointManager) {
+    _softwareBreakpointManager->maskRead(address, buffer.data(), nread);
   }
 
-  buffer.resize(nread);
   return kSuccess;
 }
 
-ErrorCode ProcessBase::writeMemoryBuffer(Address const &address,
-                                         ByteVector const &buffer,
-                                         size_t *nwritten) {
+ErrorCode ProcessBase::readMemoryBuffers(MemoryRange::Collection const &ranges,
+                                         std::vector<ByteVector> &buffers) {
   if (_pid == kAnyProcessId)
     return kErrorProcessNotFound;
-  else if (!address.valid())
+
+  buffers.assign(ranges.size(), ByteVector());
+
+  //
+  // Serve the ranges we already have from the cache and read all the others
+  // at once. Ranges that cannot be read come back empty.
+  //
+  MemoryRange::Collection uncached;
+  std::vector<size_t> indices;
+  for (size_t n = 0; n < ranges.size(); n++) {
+    MemoryRange const &range = ranges[n];
+    if (!range.start.valid() || range.length == 0)
+      continue;
+
+    if (readMemoryCached(range.start.value(), range.length, buffers[n],
+                         false) != kSuccess) {
+      uncached.push_back(range);
+      indices.push_back(n);
+    }
+  }
+
+  if (!uncached.empty()) {
+    std::vector<ByteVector> uncachedBuffers;
+    CHK(readMemoryVector(uncached, uncachedBuffers));
+    for (size_t n = 0; n < indices.size(); n++) {
+      buffers[indices[n]] = std::move(uncachedBuffers[n]);
+    }
+  }
+
+  if (_softwareBreakpointManager) {
+    for (size_t n = 0; n < ranges.size(); n++) {
+      _softwareBreakpointManager->maskRead(ranges[n].start, buffers[n].data(),
+                                           buffers[n].size());
+    }
+  }
+
+  return kSuccess;
+}
+
+ErrorCode ProcessBase::readMemoryVector(MemoryRange::Collection const &ranges,
+                                        std::vector<ByteVector> &buffers) {
+  buffers.resize(ranges.size());
+
+  for (size_t n = 0; n < ranges.size(); n++) {
+    size_t nread = 0;
+    buffers[n].resize(ranges[n].length);
+    if (readMemory(ranges[n].start, buffers[n].data(), buffers[n].size(),
+                   &nread) != kSuccess) {
+      nread = 0;
+    }
+    buffers[n].resize(nread);
+  }
+
+  return kSuccess;
+}
+
+//
+// Upper bound on the number of pages kept in the memory cache. When it is
+// reached the cache is emptied, which keeps large dumps from pinning memory.
+//
+static size_t const kMaxCachedPages = 256;
+
+//
+// Only reads spanning a few pages fill the cache. Bulk reads (memory
+// searches, checksums) would be split into one read per page and evict
+// everything else; they are only served from the cache when it already has
+// all of their pages.
+//
+static size_t const kMaxFilledPages = 16;
+
+ErrorCode ProcessBase::readMemoryCached(uint64_t address, size_t length,
+                                        ByteVector &buffer, bool fill) {
+  uint64_t pageSize = Platform::GetPageSize();
+  uint64_t pageMask = ~(pageSize - 1);
+
+  if (address + length < address)
     return kErrorInvalidArgument;
 
-  return writeMemory(address, buffer.data(), buffer.size(), nwritten);
+  uint64_t firstPage = address & pageMask;
+  uint64_t lastPage = (address + length - 1) & pageMask;
+  uint64_t pageCount = (lastPage - firstPage) / pageSize + 1;
+  if (pageCount > kMaxCachedPages)
+    return kErrorNoMemory;
+
+  if (pageCount > kMaxFilledPages) {
+    fill = false;
+  }
+
+  if (!fill) {
+    for (uint64_t n = 0; n < pageCount; n++) {
+      if (_memoryCache.find(firstPage + n * pageSize) == _memoryCache.end())
+        return kErrorNotFound;
+    }
+  }
+
+  buffer.resize(length);
+
+  for (uint64_t n = 0; n < pageCount; n++) {
+    uint64_t page = firstPage + n * pageSize;
+
+    auto it = _memoryCache.find(page);
+    if (it == _memoryCache.end()) {
+      ByteVector contents(pageSize);
+      size_t nread = 0;
+      CHK(readMemory(page, contents.data(), contents.size(), &nread));
+      if (nread != contents.size())
+        return kErrorInvalidAddress;
+
+      if (_memoryCache.size() >= kMaxCachedPages) {
+        _memoryCache.clear();
+      }
+      it = _memoryCache.emplace(page, std::move(contents)).first;
+      _memoryCacheMisses++;
+    } else {
+      _memoryCacheHits++;
+    }
+
+    uint64_t start = std::max(address, page);
+    uint64_t end = std::min(address + length, page + pageSize);
+    std::memcpy(&buffer[start - address], &it->second[start - page],
+                end - start);
+  }
+
+  return kSuccess;
+}
+
+void ProcessBase::invalidateMemoryCache() {
+  if (_memoryCache.empty())
+    return;
+
+  DS2LOG(Debug,
+         "dropping %zu cached memory pages, %" PRIu64 " hits and %" PRIu64
+         " misses so far",
+         _memoryCache.size(), _memoryCacheHits, _memoryCacheMisses);
+  _memoryCache.clear();
+}
+
+void ProcessBase::invalidateMemoryCache(Address const &address,
+                                        size_t length) {
+  if (_memoryCache.empty() || length == 0)
+    return;
+
+  uint64_t pageMask = ~static_cast<uint64_t>(Platform::GetPageSize() - 1);
+  uint64_t start = address.value();
+  uint64_t end = start + length - 1;
+  if (end < start) {
+    end = std::numeric_limits<uint64_t>::max();
+  }
+
+  auto first = _memoryCache.lower_bound(start & pageMask);
+  auto last = _memoryCache.upper_bound(end & pageMask);
+  _memoryCache.erase(first, last);
+}
+
+ErrorCode ProcessBase::writeMemoryBuffer(Address const &address,
+                                         ByteVector const &buffer,
+                                         size_t *nwritten) {
+  return writeMemoryBuffer(address, buffer, buffer.size(), nwritten);
 }
 
 ErrorCode ProcessBase::writeMemoryBuffer(Address const &address,
@@ -247,6 +424,14 @@ ErrorCode ProcessBase::writeMemoryBuffer(Address const &address,
     length = buffer.size();
   }
 
+  invalidateMemoryCache(address, length);
+
+  if (_softwareBreakpointManager) {
+    ByteVector masked(buffer.begin(), buffer.begin() + length);
+    _softwareBreakpointManager->maskWrite(address, masked.data(), length);
+    return writeMemory(address, masked.data(), length, nwritten);
+  }
+
   return writeMemory(address, buffer.data(), length, nwritten);
 }
 
@@ -280,6 +465,11 @@ ErrorCode ProcessBase::beforeResume() {
   if (!isAlive())
     return kErrorProcessNotFound;
 
+  //
+  // Whatever we read during this stop may change once the process runs.
+  //
+  invalidateMemoryCache();
+
   //
   // Enable software breakpoints.
   //
@@ -294,12 +484,19 @@ ErrorCode ProcessBase::beforeResume() {
 }
 
 ErrorCode ProcessBase::afterResume() {
+  //
+  // Threads may have been resumed internally (e.g.: to pass signals through)
+  // without going through beforeResume().
+  //
+  invalidateMemoryCache();
+
   if (!isAlive()) {
     return kSuccess;
   }
 
-  // Disable breakpoints and try to hit software breakpoints.
-  BreakpointManager *swBpm = softwareBreakpointManager();
+  // Try to hit software breakpoints. They stay in memory across stops, only
+  // the temporary ones are removed.
+  SoftwareBreakpointManager *swBpm = softwareBreakpointManager();
   if (swBpm != nullptr) {
     for (auto it : _threads) {
       BreakpointManager::Site site;
@@ -307,7 +504,7 @@ ErrorCode ProcessBase::afterResume() {
         DS2LOG(Debug, "hit breakpoint for tid %" PRI_PID, it.second->tid());
       }
     }
-    swBpm->disable();
+    swBpm->removeExpired();
   }
 
   BreakpointManager *hwBpm = hardwareBreakpointManager();
@@ -10,6 +10,8 @@
 namespace ds2 {
 namespace Target {
 
+bool ThreadBase::sStateChecking = false;
+
 ThreadBase::ThreadBase(Process *process, ThreadId tid)
     : _process(process), _tid(tid), _state(kStopped) {
   // When threads are created, they're stopped at the entry point waiting for
@@ -19,6 +21,16 @@ ThreadBase::ThreadBase(Process *process, ThreadId tid)
   _process->insert(this);
 }
 
+ErrorCode ThreadBase::readCPUStateSets(Architecture::CPUState &state,
+                                       uint32_t) {
+  return readCPUState(state);
+}
+
+ErrorCode ThreadBase::writeCPUStateSets(Architecture::CPUState const &state,
+                                        uint32_t) {
+  return writeCPUState(state);
+}
+
 ErrorCode ThreadBase::modifyRegisters(
     std::function<void(Architecture::CPUState &state)> action) {
   Architecture::CPUState state;
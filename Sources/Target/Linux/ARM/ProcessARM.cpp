@@ -318,8 +318,7 @@ ErrorCode Process::deallocateMemory(uint64_t address, size_t size) {
   // Code inject and execute
   //
   uint64_t result = 0;
-  CHK(ptrace().execute(_currentThread->tid(), info, &codestr[0], codestr.size(),
-                       result));
+  CHK(executeCode(codestr, result));
 
   if ((int)result < 0) {
     int error = -result;
@@ -23,7 +23,8 @@ static bool is32BitProcess(Process *process) {
   DS2ASSERT(process->currentThread() != nullptr);
 
   Architecture::CPUState state;
-  CHK(process->currentThread()->readCPUState(state));
+  CHK(process->currentThread()->readCPUStateSets(
+      state, Architecture::kRegisterSetGP));
 
   return state.isA32;
 }
@@ -11,22 +11,35 @@
 #include "DebugServer2/Host/Linux/ProcFS.h"
 #include "DebugServer2/Host/Platform.h"
 #include "DebugServer2/Target/Thread.h"
+#include "DebugServer2/Utils/HexValues.h"
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/String.h"
 #include "DebugServer2/Utils/Stringify.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cerrno>
+#include <climits>
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <elf.h>
+#include <fcntl.h>
+#include <iterator>
 #include <limits>
+#include <poll.h>
+#include <set>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ptrace.h>
+#include <sys/signalfd.h>
 #include <sys/wait.h>
 #if defined(HAVE_PROCESS_VM_READV) || defined(HAVE_PROCESS_VM_WRITEV)
 #include <sys/uio.h>
 #endif
 #include <unistd.h>
+#include <vector>
 
 using ds2::Host::Platform;
 using ds2::Host::Linux::ProcFS;
@@ -39,6 +52,60 @@ namespace ds2 {
 namespace Target {
 namespace Linux {
 
+Process::Process()
+    : super(), _memFd(-1), _memoryRegionsValid(false), _spawner(nullptr),
+      _epollFd(-1), _signalFd(-1), _redirectionFd(-1), _watchedFd(-1),
+      _interruptFd(-1), _interruptedTid(kAnyThreadId) {}
+
+Process::~Process() {
+  closeEventLoop();
+  closeMemoryFd();
+}
+
+void Process::cleanup() {
+  closeEventLoop();
+  closeMemoryFd();
+  super::cleanup();
+}
+
+static pid_t blocking_waitpid(pid_t pid, int *status, int flags) {
+  pid_t ret;
+  do {
+    ret = ::waitpid(pid, status, flags);
+  } while (ret == -1 && errno == EINTR);
+
+  return ret;
+}
+
+static bool IsSIGCHLDBlocked() {
+  sigset_t mask;
+  if (::pthread_sigmask(SIG_BLOCK, nullptr, &mask) != 0)
+    return false;
+  return sigismember(&mask, SIGCHLD) == 1;
+}
+
+void Process::prepareSpawner(Host::ProcessSpawner &spawner) {
+  //
+  // When we can wait for SIGCHLD on a signalfd, the inferior's console is
+  // read from the same loop instead of a separate thread.
+  //
+  _spawner = &spawner;
+  _spawner->setManualRedirection(IsSIGCHLDBlocked());
+  _ptrace.prepareTraceMe();
+}
+
+ErrorCode Process::initialize(ProcessId pid, uint32_t flags) {
+  //
+  // In seize mode, a child we spawned doesn't trace itself; it waits for us
+  // to seize it before calling exec.
+  //
+  if ((flags & kFlagNewProcess) && _ptrace.seizing()) {
+    CHK(_ptrace.seize(pid));
+  }
+
+  return super::initialize(pid, flags);
+}
+
 ErrorCode Process::attach(int waitStatus) {
   if (waitStatus <= 0) {
     CHK(ptrace().attach(_pid));
@@ -47,69 +114,484 @@ ErrorCode Process::attach(int waitStatus) {
     ptrace().traceThat(_pid);
   }
 
+  //
+  // Create the main thread, ourselves.
+  //
+  _currentThread = new Thread(this, _pid);
+  recordAttachStop(static_cast<Thread *>(_currentThread), waitStatus);
+
   if (_flags & kFlagAttachedProcess) {
-    //
-    // Enumerate all the tasks and create a Thread
-    // object for every entry.
-    //
-    bool keepGoing = true;
+    attachThreads(waitStatus);
+  }
+
+  // Interrupts go through the event loop in seize mode, so it has to be
+  // ready before the session can ask for one.
+  if (_ptrace.seizing()) {
+    setupEventLoop();
+  }
+
+  return kSuccess;
+}
+
+//
+// Attaches to every thread but the main one in bulk: we attach to all the
+// threads we can find without waiting for any of them, and then collect all
+// the stops at once. Threads can be created by threads we haven't attached to
+// yet, so we enumerate until a round finds nothing new.
+//
+// Threads attached with PTRACE_ATTACH only follow their clones once they
+// stopped and we set their options, so in that mode each round is collected
+// before the next enumeration. In seize mode, the options are set right away
+// and attaching doesn't stop the threads; we only interrupt them when we
+// have them all, which keeps the time the inferior spends partially stopped
+// short. Threads they create in the meantime are attached by
+// PTRACE_O_TRACECLONE and we learn about them from the clone event, which
+// may also be what the main thread reported in `mainStatus'.
+//
+void Process::attachThreads(int mainStatus) {
+  std::set<ThreadId> pending;
+  std::set<ThreadId> skipped;
+
+  auto trackClone = [&](ThreadId tid, int status) {
+    if (status >> 8 != (SIGTRAP | (PTRACE_EVENT_CLONE << 8)))
+      return;
 
     //
-    // Try to find threads of the newly attached process in multiple
-    // rounds so that we avoid race conditions with threads being
-    // created before we stop the creator.
+    // The child is stopped, or about to stop, at its entry point; make sure
+    // we collect it too.
     //
-    while (keepGoing) {
-      keepGoing = false;
+    unsigned long data;
+    if (ptrace().getEventMessage(ProcessThreadId(_pid, tid), data) ==
+            kSuccess &&
+        _threads.find(data) == _threads.end()) {
+      new Thread(this, data);
+      pending.insert(data);
+    }
+  };
 
-      ProcFS::EnumerateThreads(_pid, [&](pid_t tid) {
-        //
-        // Attach the thread to the debugger and wait
-        //
-        if (thread(tid) != nullptr || tid == _pid)
-          return;
-
-        keepGoing = true;
-        auto thread = new Thread(this, tid);
-        if (ptrace().attach(tid) == kSuccess) {
-          int status;
-          ptrace().wait(tid, &status);
-          ptrace().traceThat(tid);
-          thread->updateStopInfo(status);
-        }
-      });
+  //
+  // The stops are collected one thread at a time: waitpid(2) on a given tid
+  // is cheap, while waiting for any thread has the kernel go through all of
+  // our tracees on every call.
+  //
+  auto collectStops = [&]() {
+    DS2LOG(Debug, "waiting for %zu threads to stop", pending.size());
+
+    while (!pending.empty()) {
+      ThreadId tid = *pending.begin();
+      pending.erase(pending.begin());
+
+      int status;
+      if (blocking_waitpid(tid, &status, __WALL) != tid) {
+        DS2LOG(Warning, "unable to wait for tid %" PRI_PID ": %s", tid,
+               Stringify::Errno(errno));
+        removeThread(tid);
+        continue;
+      }
+
+      Thread *thread = static_cast<Thread *>(_threads.find(tid)->second);
+      if (WIFSTOPPED(status) && !_ptrace.seizing()) {
+        ptrace().traceThat(tid);
+      }
+
+      recordAttachStop(thread, status);
+      if (thread->_state == Thread::kTerminated) {
+        removeThread(tid);
+        continue;
+      }
+
+      trackClone(tid, status);
+    }
+  };
+
+  trackClone(_pid, mainStatus);
+
+  bool keepGoing = true;
+  while (keepGoing) {
+    keepGoing = false;
+
+    ProcFS::EnumerateThreads(_pid, [&](pid_t tid) {
+      if (_threads.find(tid) != _threads.end() ||
+          skipped.find(tid) != skipped.end())
+        return;
+
+      keepGoing = true;
+      ErrorCode error =
+          _ptrace.seizing() ? _ptrace.seize(tid) : ptrace().attach(tid);
+      if (error == kSuccess) {
+        new Thread(this, tid);
+        pending.insert(tid);
+      } else {
+        // The thread exited before we could attach to it, or it was cloned
+        // by a thread we had already seized, and is ours already.
+        skipped.insert(tid);
+      }
+    });
+
+    if (!_ptrace.seizing()) {
+      collectStops();
+    }
+  }
+
+  if (_ptrace.seizing()) {
+    for (auto tid : pending) {
+      ptrace().suspend(ProcessThreadId(_pid, tid));
+    }
+    collectStops();
+  }
+}
+
+//
+// PTRACE_INTERRUPT stops a thread we seized with a PTRACE_EVENT_STOP, which is
+// otherwise how threads we suspend report, and a clone event is reported the
+// same way. Make them look like the SIGSTOP that PTRACE_ATTACH sends.
+//
+void Process::recordAttachStop(Thread *thread, int status) {
+  thread->updateStopInfo(status);
+  if (thread->_state == Thread::kStopped) {
+    thread->reconcileState();
+  }
+  if (thread->_stopInfo.event == StopInfo::kEventNone) {
+    thread->_stopInfo.event = StopInfo::kEventStop;
+    thread->_stopInfo.reason = StopInfo::kReasonSignalStop;
+    thread->_stopInfo.signal = SIGSTOP;
+  }
+}
+
+//
+// Event loop
+//
+// Instead of sleeping in waitpid(2), we multiplex a signalfd for SIGCHLD and
+// the inferior's terminal in a single epoll set. This lets us forward the
+// console output as it is produced without a dedicated thread, and drain it
+// before reporting the stop it precedes. The session can add its own
+// descriptor to the set (see watchDescriptor()), so that an interrupt request
+// is read and acted upon by the tracer thread itself.
+//
+bool Process::setupEventLoop() {
+  if (_epollFd >= 0)
+    return true;
+
+  if (!IsSIGCHLDBlocked())
+    return false;
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+
+  _signalFd = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (_signalFd < 0) {
+    DS2LOG(Warning, "unable to create signalfd: %s", Stringify::Errno(errno));
+    return false;
+  }
+
+  _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (_epollFd < 0) {
+    DS2LOG(Warning, "unable to create epoll: %s", Stringify::Errno(errno));
+    closeEventLoop();
+    return false;
+  }
+
+  struct epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = _signalFd;
+  if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, _signalFd, &event) < 0) {
+    closeEventLoop();
+    return false;
+  }
+
+  if (_spawner != nullptr && _spawner->redirectionFd() >= 0) {
+    event.data.fd = _spawner->redirectionFd();
+    if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, event.data.fd, &event) == 0) {
+      _redirectionFd = event.data.fd;
+    }
+  }
+
+  if (_watchedFd >= 0) {
+    event.data.fd = _watchedFd;
+    if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, _watchedFd, &event) < 0) {
+      DS2LOG(Warning, "unable to watch fd %d: %s", _watchedFd,
+             Stringify::Errno(errno));
     }
   }
 
   //
-  // Create the main thread, ourselves.
+  // PTRACE_INTERRUPT has to be issued by the tracer thread, while interrupt()
+  // is called from the session thread; it pokes us through an eventfd.
   //
-  _currentThread = new Thread(this, _pid);
-  _currentThread->updateStopInfo(waitStatus);
+  if (_ptrace.seizing()) {
+    event.data.fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event.data.fd >= 0 &&
+        ::epoll_ctl(_epollFd, EPOLL_CTL_ADD, event.data.fd, &event) < 0) {
+      ::close(event.data.fd);
+      event.data.fd = -1;
+    }
+    std::lock_guard<std::mutex> guard(_interruptLock);
+    _interruptFd = event.data.fd;
+  }
+
+  return true;
+}
+
+void Process::closeEventLoop() {
+  if (_epollFd >= 0) {
+    ::close(_epollFd);
+    _epollFd = -1;
+  }
+  if (_signalFd >= 0) {
+    ::close(_signalFd);
+    _signalFd = -1;
+  }
+  {
+    std::lock_guard<std::mutex> guard(_interruptLock);
+    if (_interruptFd >= 0) {
+      ::close(_interruptFd);
+      _interruptFd = -1;
+    }
+  }
+  _redirectionFd = -1;
+}
+
+void Process::pumpRedirection() {
+  if (_redirectionFd < 0)
+    return;
+
+  //
+  // Remove the terminal from the set before the spawner closes it on hangup,
+  // so that a later descriptor with the same number doesn't confuse us.
+  //
+  int fd = _redirectionFd;
+  if (!_spawner->pumpRedirection()) {
+    ::epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    _redirectionFd = -1;
+  }
+}
+
+bool Process::watchDescriptor(int fd,
+                              std::function<bool()> const &handler) {
+  if (_epollFd >= 0 && _watchedFd >= 0) {
+    ::epoll_ctl(_epollFd, EPOLL_CTL_DEL, _watchedFd, nullptr);
+  }
+
+  _watchedFd = fd;
+  _watchedHandler = handler;
+
+  if (_epollFd >= 0 && _watchedFd >= 0) {
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = _watchedFd;
+    if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, _watchedFd, &event) < 0) {
+      DS2LOG(Warning, "unable to watch fd %d: %s", _watchedFd,
+             Stringify::Errno(errno));
+    }
+  }
+
+  return true;
+}
+
+void Process::pumpWatchedDescriptor() {
+  if (_watchedFd < 0 || _watchedHandler())
+    return;
+
+  //
+  // The handler is done with its descriptor (e.g.: the peer hung up); stop
+  // watching it before it is closed and its number reused.
+  //
+  if (_epollFd >= 0) {
+    ::epoll_ctl(_epollFd, EPOLL_CTL_DEL, _watchedFd, nullptr);
+  }
+  _watchedFd = -1;
+  _watchedHandler = nullptr;
+}
+
+ErrorCode Process::interrupt() {
+  std::lock_guard<std::mutex> guard(_interruptLock);
+  if (_interruptFd < 0) {
+    //
+    // Without an event loop, fall back to a SIGSTOP. In seize mode, the
+    // thread that takes it may report a PTRACE_EVENT_STOP, which only counts
+    // as an interruption if we asked for one; let any thread answer.
+    //
+    if (_ptrace.seizing()) {
+      _interruptedTid = kAllThreadId;
+    }
+    return super::interrupt();
+  }
+
+  if (::eventfd_write(_interruptFd, 1) < 0)
+    return Platform::TranslateError();
 
   return kSuccess;
 }
 
-static pid_t blocking_waitpid(pid_t pid, int *status, int flags) {
-  pid_t ret;
-  do {
-    ret = ::waitpid(pid, status, flags);
-  } while (ret == -1 && errno == EINTR);
+//
+// Called when `tid' stops, tells whether that stop answers the last
+// interrupt() request; the request is then cleared.
+//
+bool Process::answersInterrupt(ThreadId tid) {
+  std::lock_guard<std::mutex> guard(_interruptLock);
+  if (_interruptedTid != tid && _interruptedTid != kAllThreadId)
+    return false;
 
-  return ret;
+  _interruptedTid = kAnyThreadId;
+  return true;
+}
+
+//
+// Any stop we report to the debugger answers a pending interrupt() request,
+// whichever thread it comes from.
+//
+void Process::clearInterrupt() {
+  std::lock_guard<std::mutex> guard(_interruptLock);
+  _interruptedTid = kAnyThreadId;
+}
+
+//
+// Stops one thread on behalf of interrupt(); its PTRACE_EVENT_STOP is then
+// reported like the SIGSTOP the process would otherwise have received.
+//
+void Process::interruptRunningThread() {
+  Thread *target = nullptr;
+  for (auto const &it : _threads) {
+    Thread *thread = static_cast<Thread *>(it.second);
+    if (thread->_state != Thread::kRunning &&
+        thread->_state != Thread::kStepped)
+      continue;
+    if (thread->isZombieLeader())
+      continue;
+
+    target = thread;
+    if (thread->tid() == _pid)
+      break;
+  }
+
+  if (target == nullptr) {
+    DS2LOG(Debug, "no running thread to interrupt");
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(_interruptLock);
+  if (ptrace().suspend(ProcessThreadId(_pid, target->tid())) == kSuccess) {
+    _interruptedTid = target->tid();
+  }
+}
+
+ThreadId Process::waitForEvent(int *status) {
+  if (!setupEventLoop()) {
+    //
+    // Without the event loop, the watched descriptor can only be serviced
+    // between non-blocking waits.
+    //
+    while (_watchedFd >= 0) {
+      pid_t tid = blocking_waitpid(-1, status, __WALL | WNOHANG);
+      if (tid != 0)
+        return tid;
+
+      struct pollfd pfd;
+      pfd.fd = _watchedFd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (::poll(&pfd, 1, 10) > 0) {
+        pumpWatchedDescriptor();
+      }
+    }
+    return blocking_waitpid(-1, status, __WALL);
+  }
+
+  for (;;) {
+    pid_t tid = blocking_waitpid(-1, status, __WALL | WNOHANG);
+    if (tid != 0) {
+      pumpRedirection();
+      return tid;
+    }
+
+    struct epoll_event events[4];
+    int nfds = ::epoll_wait(_epollFd, events, 4, -1);
+    if (nfds < 0) {
+      if (errno == EINTR)
+        continue;
+      DS2LOG(Warning, "epoll_wait failed: %s", Stringify::Errno(errno));
+      return blocking_waitpid(-1, status, __WALL);
+    }
+
+    for (int n = 0; n < nfds; n++) {
+      if (events[n].data.fd == _signalFd) {
+        struct signalfd_siginfo info;
+        while (::read(_signalFd, &info, sizeof(info)) == sizeof(info))
+          continue;
+      } else if (events[n].data.fd == _interruptFd) {
+        eventfd_t value;
+        ::eventfd_read(events[n].data.fd, &value);
+        interruptRunningThread();
+      } else if (events[n].data.fd == _watchedFd) {
+        pumpWatchedDescriptor();
+      } else {
+        pumpRedirection();
+      }
+    }
+  }
+}
+
+int Process::memoryFd() {
+  if (_memFd < 0) {
+    _memFd = ProcFS::OpenFd(_pid, "mem", O_RDWR | O_CLOEXEC);
+    if (_memFd < 0) {
+      DS2LOG(Debug, "unable to open /proc/%" PRI_PID "/mem: %s", _pid,
+             Stringify::Errno(errno));
+    }
+  }
+  return _memFd;
+}
+
+void Process::closeMemoryFd() {
+  if (_memFd >= 0) {
+    ::close(_memFd);
+    _memFd = -1;
+  }
 }
 
 ErrorCode Process::readMemory(Address const &address, void *data, size_t length,
                               size_t *count) {
-#if defined(HAVE_PROCESS_VM_READV)
-  // Using process_vm_readv() is faster than using ptrace() because we can do
-  // bigger reads that ptrace() (which can only read a word at a time); the
-  // drawback is that process_vm_readv() cannot bypass page-level permissions
-  // like ptrace() can.
-  // This is why for reads smaller than word-size we go straight to the
-  // fallback so we reduce the number of possible process_vm_readv() failures.
-  // The most common occurence of this is when writing breakpoints.
+  // Accesses to /proc/<pid>/mem go through the same path as ptrace() in the
+  // kernel, so they can read pages that are not readable by the inferior
+  // (e.g.: execute-only text), but they are not limited to a word at a time.
+  // The file descriptor is opened once and kept for the lifetime of the
+  // process. It stops working when the inferior execs (the descriptor stays
+  // bound to the old address space and reads return 0), in which case we
+  // drop it and reopen it on the next access.
+  int fd = memoryFd();
+  if (fd >= 0) {
+    size_t done = 0;
+    while (done < length) {
+      ssize_t ret = ::pread(fd, static_cast<char *>(data) + done,
+                            length - done, address.value() + done);
+      if (ret < 0 && errno == EINTR)
+        continue;
+      if (ret <= 0) {
+        if (ret == 0 && done == 0) {
+          closeMemoryFd();
+        }
+        break;
+      }
+      done += ret;
+    }
 
+    if (done > 0) {
+      if (count != nullptr) {
+        *count = done;
+      }
+      return kSuccess;
+    }
+  }
+
+#if defined(HAVE_PROCESS_VM_READV)
+  // process_vm_readv() cannot bypass page-level permissions like ptrace() can,
+  // but it still does bigger reads than ptrace() (which can only read a word
+  // at a time). This is why for reads smaller than word-size we go straight
+  // to the fallback so we reduce the number of possible process_vm_readv()
+  // failures.
   if (length > sizeof(uintptr_t)) {
     struct iovec local_iov = {data, length};
     struct iovec remote_iov = {reinterpret_cast<void *>(address.value()),
@@ -132,8 +614,34 @@ ErrorCode Process::readMemory(Address const &address, void *data, size_t length,
 
 ErrorCode Process::writeMemory(Address const &address, void const *data,
                                size_t length, size_t *count) {
+  // See comment in Process::readMemory. Writes through /proc/<pid>/mem also
+  // ignore page protections, which is what we want for breakpoints in text.
+  int fd = memoryFd();
+  if (fd >= 0) {
+    size_t done = 0;
+    while (done < length) {
+      ssize_t ret = ::pwrite(fd, static_cast<char const *>(data) + done,
+                             length - done, address.value() + done);
+      if (ret < 0 && errno == EINTR)
+        continue;
+      if (ret <= 0) {
+        if (ret == 0 && done == 0) {
+          closeMemoryFd();
+        }
+        break;
+      }
+      done += ret;
+    }
+
+    if (done > 0) {
+      if (count != nullptr) {
+        *count = done;
+      }
+      return kSuccess;
+    }
+  }
+
 #if defined(HAVE_PROCESS_VM_WRITEV)
-  // See comment in Process::readMemory.
   if (length > sizeof(uintptr_t)) {
     struct iovec local_iov = {const_cast<void *>(data), length};
     struct iovec remote_iov = {reinterpret_cast<void *>(address.value()),
@@ -154,6 +662,57 @@ ErrorCode Process::writeMemory(Address const &address, void const *data,
   return super::writeMemory(address, data, length, count);
 }
 
+ErrorCode Process::readMemoryVector(MemoryRange::Collection const &ranges,
+                                   std::vector<ByteVector> &buffers) {
+#if defined(HAVE_PROCESS_VM_READV)
+  // A single process_vm_readv() call can fetch all the ranges. It stops at the
+  // first range it cannot read entirely; that range goes through readMemory(),
+  // which can also read pages the inferior itself cannot, and the call is
+  // repeated for the ranges that follow it.
+  std::vector<struct iovec> localIov(ranges.size());
+  std::vector<struct iovec> remoteIov(ranges.size());
+
+  buffers.resize(ranges.size());
+  for (size_t n = 0; n < ranges.size(); n++) {
+    buffers[n].resize(ranges[n].length);
+    localIov[n].iov_base = buffers[n].data();
+    localIov[n].iov_len = buffers[n].size();
+    remoteIov[n].iov_base = reinterpret_cast<void *>(ranges[n].start.value());
+    remoteIov[n].iov_len = buffers[n].size();
+  }
+
+  auto id = _currentThread == nullptr ? _pid : _currentThread->tid();
+
+  size_t next = 0;
+  while (next < ranges.size()) {
+    size_t count = std::min<size_t>(ranges.size() - next, IOV_MAX);
+    ssize_t ret = process_vm_readv(id, &localIov[next], count,
+                                   &remoteIov[next], count, 0);
+    size_t left = ret < 0 ? 0 : ret;
+
+    size_t last = next + count;
+    while (next < last && left >= localIov[next].iov_len) {
+      left -= localIov[next].iov_len;
+      next++;
+    }
+
+    if (next < last) {
+      size_t nread = 0;
+      if (readMemory(ranges[next].start, buffers[next].data(),
+                     buffers[next].size(), &nread) != kSuccess) {
+        nread = 0;
+      }
+      buffers[next].resize(nread);
+      next++;
+    }
+  }
+
+  return kSuccess;
+#else
+  return super::readMemoryVector(ranges, buffers);
+#endif
+}
+
 ErrorCode Process::checkMemoryErrorCode(uint64_t address) {
   // mmap() returns MAP_FAILED thanks to the libc wrapper. Here we don't have
   // any, so we get the raw kernel return value, which is the address of the
@@ -177,7 +736,7 @@ ErrorCode Process::wait() {
   DS2ASSERT(!_threads.empty());
 
   while (!_threads.empty()) {
-    tid = blocking_waitpid(-1, &status, __WALL);
+    tid = waitForEvent(&status);
     if (tid <= 0) {
       return kErrorProcessNotFound;
     }
@@ -228,6 +787,8 @@ ErrorCode Process::wait() {
       //       waitpid(3) call and thus have to handle the cloned thread
       //       and the currentThread at once. So we call step on the
       //       _currentThread and then beforeResume the cloned thread.
+      // 3. in a group-stop (see Linux::Thread::updateStopInfo). Resuming it
+      //    leaves it stopped until the process gets a SIGCONT.
       //
       // We also have another theoretically possible case where we are not
       // stopped by a clone but still stepping while encountering a kEventNone.
@@ -262,14 +823,32 @@ ErrorCode Process::wait() {
           // thread.
           _currentThread->step();
         }
+      } else if (stepping && _currentThread->_groupStopped) {
+        // The process was stopped by a signal before the thread could take
+        // its step. Park it until SIGCONT, then step again as below.
+        _currentThread->resume();
+        _currentThread->_state = Thread::kStepped;
+      } else if (stepping && _currentThread->_stopInfo.signal == SIGSTOP) {
+        // A SIGSTOP we sent while suspending the process was still queued
+        // when we started stepping (the thread had stopped for something
+        // else in the meantime). It is delivered before the instruction is
+        // executed, so step again.
+#if defined(ARCH_ARM)
+        // The single-step breakpoints are still in place.
+        _currentThread->resume();
+        _currentThread->_state = Thread::kStepped;
+#else
+        _currentThread->step();
+#endif
       } else if (stepping) {
         // We should never see a case where we're:
         //   1. stopped for event kEventNone
         //   2. stepping
-        //   3. not stopped for reason kReasonThreadSpawn
+        //   3. not stopped for reason kReasonThreadSpawn or because of a
+        //      SIGSTOP we sent
         DS2BUG("inconsistent thread stop info");
       } else {
-        _currentThread->resume(); // (1) and (2a)
+        _currentThread->resume(); // (1), (2a) and (3)
       }
       goto continue_waiting;
 
@@ -321,6 +900,13 @@ ErrorCode Process::wait() {
     continue;
   }
 
+  if (_currentThread != nullptr && _currentThread->_state == Thread::kStopped) {
+    clearInterrupt();
+
+    // Picks up the core the thread stopped on, which ptrace can't tell us.
+    _currentThread->reconcileState();
+  }
+
   if (!(WIFEXITED(status) || WIFSIGNALED(status)) || tid != _pid) {
     //
     // Suspend the process, this must be done after updating
@@ -336,6 +922,164 @@ ErrorCode Process::wait() {
   return kSuccess;
 }
 
+//
+// Records an event reaped while suspending the process. Anything other than
+// the SIGSTOP we sent (a breakpoint, a signal, an exit) is kept in the
+// thread's stop info and reported along with the stop, as wait() would.
+// The thread is stopped for good then, so this is also when we learn which
+// core it is on.
+//
+void Process::recordSuspendEvent(ThreadId tid, int status) {
+  DS2LOG(Debug, "tid %" PRI_PID " %s", tid, Stringify::WaitStatus(status));
+
+  auto it = _threads.find(tid);
+  if (it == _threads.end()) {
+    // Either a thread we already forgot about exiting, or a thread that was
+    // just cloned and is stopped at its entry point.
+    if (!(WIFEXITED(status) || WIFSIGNALED(status))) {
+      DS2LOG(Debug, "creating new thread tid=%d", tid);
+      new Thread(this, tid);
+    }
+    return;
+  }
+
+  Thread *thread = static_cast<Thread *>(it->second);
+  thread->updateStopInfo(status);
+  if (thread->_state == Thread::kStopped) {
+    thread->reconcileState();
+  }
+}
+
+//
+// Reaps events until the thread group leader has reported, without ever
+// blocking on it; see suspend().
+//
+void Process::waitForLeaderSuspend() {
+  auto it = _threads.find(_pid);
+  while (it != _threads.end()) {
+    Thread *leader = static_cast<Thread *>(it->second);
+    if (leader->_state != Thread::kRunning)
+      return;
+
+    int status;
+    ThreadId tid = blocking_waitpid(-1, &status, __WALL | WNOHANG);
+    if (tid < 0) {
+      DS2LOG(Warning, "unable to wait for tid %" PRI_PID ": %s", _pid,
+             Stringify::Errno(errno));
+      return;
+    }
+
+    if (tid > 0) {
+      recordSuspendEvent(tid, status);
+      it = _threads.find(_pid);
+      continue;
+    }
+
+    if (leader->isZombieLeader()) {
+      leader->_state = Thread::kTerminated;
+      return;
+    }
+
+    //
+    // Sleep until a child changes state. The leader becoming a zombie
+    // doesn't send SIGCHLD, hence the timeout.
+    //
+    struct pollfd pfd;
+    pfd.fd = _signalFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (::poll(&pfd, _signalFd < 0 ? 0 : 1, 10) > 0) {
+      struct signalfd_siginfo info;
+      while (::read(_signalFd, &info, sizeof(info)) == sizeof(info))
+        continue;
+    }
+  }
+}
+
+ErrorCode Process::suspend() {
+  //
+  // Stopping every thread is done in phases so that it costs about the same
+  // whatever the number of threads: collect the events threads already have
+  // pending, signal every thread that is still running, and only then reap
+  // all the stops.
+  //
+  ThreadId tid;
+  int status;
+
+  while ((tid = blocking_waitpid(-1, &status, __WALL | WNOHANG)) > 0) {
+    recordSuspendEvent(tid, status);
+  }
+
+  std::vector<ThreadId> signaled;
+  for (auto const &it : _threads) {
+    Thread *thread = static_cast<Thread *>(it.second);
+
+    // A step only lasts until the next event. If another thread reported
+    // first, a thread we were stepping is still running.
+    if (thread->_state == Thread::kStepped) {
+      thread->_state = Thread::kRunning;
+    }
+
+    if (thread->_state != Thread::kRunning)
+      continue;
+
+    if (thread->isZombieLeader()) {
+      thread->_state = Thread::kTerminated;
+      continue;
+    }
+
+    DS2LOG(Debug, "suspending tid %" PRI_PID, thread->tid());
+    if (ptrace().suspend(ProcessThreadId(_pid, thread->tid())) == kSuccess) {
+      signaled.push_back(thread->tid());
+    } else {
+      // The thread is already gone.
+      thread->_state = Thread::kTerminated;
+    }
+  }
+
+  //
+  // Waiting for a given tid is cheap, while waiting for any thread has the
+  // kernel go through all of our tracees on every call. That is fine for
+  // every thread but the leader: if it exits while we suspend (e.g.: another
+  // thread calls exit_group(2)), it isn't reported until all the other
+  // threads have been reaped, including the ones we didn't signal; and if it
+  // exits on its own, it isn't reported at all. The leader is collected
+  // last, along with whatever else reports meanwhile.
+  //
+  bool leaderSignaled = false;
+  for (auto const &tid : signaled) {
+    if (tid == _pid) {
+      leaderSignaled = true;
+      continue;
+    }
+
+    if (blocking_waitpid(tid, &status, __WALL) != tid) {
+      DS2LOG(Warning, "unable to wait for tid %" PRI_PID ": %s", tid,
+             Stringify::Errno(errno));
+      continue;
+    }
+
+    recordSuspendEvent(tid, status);
+  }
+
+  if (leaderSignaled) {
+    waitForLeaderSuspend();
+  }
+
+  std::vector<ThreadId> terminated;
+  for (auto const &it : _threads) {
+    if (it.second->state() == Thread::kTerminated) {
+      terminated.push_back(it.first);
+    }
+  }
+  for (auto const &tid : terminated) {
+    DS2LOG(Debug, "tid %" PRI_PID " exited while suspending", tid);
+    removeThread(tid);
+  }
+
+  return kSuccess;
+}
+
 ErrorCode Process::terminate() {
   ErrorCode error = super::terminate();
   if (error == kSuccess || error == kErrorProcessNotFound) {
@@ -419,88 +1163,164 @@ ErrorCode Process::updateInfo() {
   return kSuccess;
 }
 
-ErrorCode Process::getMemoryRegionInfo(Address const &address,
-                                       MemoryRegionInfo &info) {
-  if (!address.valid()) {
-    return kErrorInvalidArgument;
+//
+// Parses one line of /proc/<pid>/maps:
+//   start-end perms offset major:minor inode [path]
+//
+static bool ParseMapsHex(char const *&ptr, char const *end, uint64_t &value) {
+  char const *first = ptr;
+  value = 0;
+  while (ptr < end && std::isxdigit(*ptr)) {
+    value = (value << 4) | HexToNibble(*ptr++);
   }
+  return ptr != first;
+}
 
-  info.clear();
+static bool ParseMapsLine(char const *ptr, char const *end,
+                          MemoryRegionInfo &info) {
+  uint64_t start, finish, offset, major, minor, inode = 0;
 
-  FILE *fp = ProcFS::OpenFILE(_pid, "maps");
-  if (fp == nullptr) {
-    return Platform::TranslateError();
+  if (!ParseMapsHex(ptr, end, start) || ptr == end || *ptr++ != '-')
+    return false;
+  if (!ParseMapsHex(ptr, end, finish) || ptr == end || *ptr++ != ' ')
+    return false;
+
+  if (end - ptr < 5 || ptr[4] != ' ')
+    return false;
+  info.protection = 0;
+  if (ptr[0] == 'r')
+    info.protection |= ds2::kProtectionRead;
+  if (ptr[1] == 'w')
+    info.protection |= ds2::kProtectionWrite;
+  if (ptr[2] == 'x')
+    info.protection |= ds2::kProtectionExecute;
+  ptr += 5;
+
+  if (!ParseMapsHex(ptr, end, offset) || ptr == end || *ptr++ != ' ')
+    return false;
+  if (!ParseMapsHex(ptr, end, major) || ptr == end || *ptr++ != ':')
+    return false;
+  if (!ParseMapsHex(ptr, end, minor) || ptr == end || *ptr++ != ' ')
+    return false;
+  while (ptr < end && std::isdigit(*ptr)) {
+    inode = inode * 10 + (*ptr++ - '0');
   }
 
-  uint64_t last = 0;
-  bool found = false;
+  while (ptr < end && std::isspace(*ptr)) {
+    ++ptr;
+  }
 
-  while (!found) {
-    // Each line can contain one path and some additional addresses and
-    // such, so PATH_MAX * 2 should be enough.
-    char buf[PATH_MAX * 2];
-    uint64_t start, end;
-    char r, w, x, p;
-    uint64_t offset;
-    unsigned int devMinor, devMajor;
-    uint64_t inode;
-    char name[PATH_MAX + 1];
-    int nread;
+  info.start = start;
+  info.length = finish - start;
+  info.backingFile.assign(ptr, end);
+  info.name = info.backingFile.substr(0, info.backingFile.find(' '));
+  info.backingFileOffset = offset;
+  info.backingFileInode = inode;
+  return true;
+}
 
-    if (::fgets(buf, sizeof(buf), fp) == nullptr) {
-      if (::feof(fp)) {
-        break;
-      } else {
-        DS2ASSERT(errno != 0);
-        return Platform::TranslateError();
-      }
-    }
+ErrorCode Process::updateMemoryRegions() {
+  if (_memoryRegionsValid)
+    return kSuccess;
 
-    if (::sscanf(buf,
-                 "%" PRIx64 "-%" PRIx64 " %c%c%c%c %" PRIx64 " %x:%x %" PRIu64
-                 " %" STR(PATH_MAX) "s%n",
-                 &start, &end, &r, &w, &x, &p, &offset, &devMinor, &devMajor,
-                 &inode, name, &nread) != 11) {
+  int fd = ProcFS::OpenFd(_pid, "maps");
+  if (fd < 0) {
+    return Platform::TranslateError();
+  }
+
+  std::string contents;
+  char buf[64 * 1024];
+  for (;;) {
+    ssize_t ret = ::read(fd, buf, sizeof(buf));
+    if (ret < 0 && errno == EINTR)
       continue;
+    if (ret < 0) {
+      ErrorCode error = Platform::TranslateError();
+      ::close(fd);
+      return error;
     }
+    if (ret == 0)
+      break;
+    contents.append(buf, ret);
+  }
+  ::close(fd);
 
-    if (address >= last && address < start) {
-      //
-      // A hole.
-      //
-      info.start = last;
-      info.length = start - last;
-      info.name = name;
-      found = true;
-    } else if (address >= start && address < end) {
-      //
-      // A defined region.
-      //
-      info.start = start;
-      info.length = end - start;
-      info.protection = 0;
-      if (r == 'r')
-        info.protection |= ds2::kProtectionRead;
-      if (w == 'w')
-        info.protection |= ds2::kProtectionWrite;
-      if (x == 'x')
-        info.protection |= ds2::kProtectionExecute;
-      while (buf[nread] != '\0' && std::isspace(buf[nread]))
-        ++nread;
-      info.name = name;
-      info.backingFile = buf + nread;
-      info.backingFileOffset = offset;
-      info.backingFileInode = inode;
-      found = true;
-    } else {
-      last = end;
+  //
+  // The kernel lists the mappings in increasing address order, which lets
+  // getMemoryRegionInfo() use a binary search.
+  //
+  _memoryRegions.clear();
+  char const *ptr = contents.data();
+  char const *end = ptr + contents.size();
+  while (ptr < end) {
+    auto eol = static_cast<char const *>(std::memchr(ptr, '\n', end - ptr));
+    if (eol == nullptr) {
+      eol = end;
+    }
+
+    MemoryRegionInfo info;
+    if (ParseMapsLine(ptr, eol, info)) {
+      _memoryRegions.push_back(std::move(info));
     }
+    ptr = eol + 1;
   }
-  std::fclose(fp);
 
-  if (!found) {
-    info.start = last;
+  _memoryRegionsValid = true;
+  return kSuccess;
+}
+
+void Process::invalidateMemoryCache() {
+  // Mappings may change as soon as the inferior runs or executes our code.
+  _memoryRegions.clear();
+  _memoryRegionsValid = false;
+  super::invalidateMemoryCache();
+}
+
+ErrorCode Process::enumerateMemoryRegions(
+    std::function<void(MemoryRegionInfo const &)> const &cb) {
+  CHK(updateMemoryRegions());
+
+  for (auto const &region : _memoryRegions) {
+    cb(region);
+  }
+
+  return kSuccess;
+}
+
+ErrorCode Process::getMemoryRegionInfo(Address const &address,
+                                       MemoryRegionInfo &info) {
+  if (!address.valid()) {
+    return kErrorInvalidArgument;
+  }
+
+  CHK(updateMemoryRegions());
 
+  //
+  // Find the first region that ends after the address; the address is either
+  // in it or in the hole right before it.
+  //
+  auto it = std::upper_bound(
+      _memoryRegions.begin(), _memoryRegions.end(), address.value(),
+      [](uint64_t value, MemoryRegionInfo const &region) {
+        return value < region.start + region.length;
+      });
+
+  if (it != _memoryRegions.end() && address >= it->start) {
+    info = *it;
+    return kSuccess;
+  }
+
+  info.clear();
+  if (it != _memoryRegions.begin()) {
+    auto prev = std::prev(it);
+    info.start = prev->start + prev->length;
+  } else {
+    info.start = 0;
+  }
+
+  if (it != _memoryRegions.end()) {
+    info.length = it->start - info.start;
+  } else {
     //
     // We need to obtain the end of the address space, first
     // we need to know if it's 64-bit.
@@ -524,6 +1344,10 @@ ErrorCode Process::executeCode(ByteVector const &codestr, uint64_t &result) {
   ProcessInfo info;
 
   CHK(getInfo(info));
+
+  // The code we run temporarily replaces memory and can change mappings.
+  invalidateMemoryCache();
+
   CHK(ptrace().execute(_currentThread->tid(), info, &codestr[0], codestr.size(),
                        result));
 
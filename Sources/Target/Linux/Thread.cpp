@@ -27,10 +27,12 @@ namespace ds2 {
 namespace Target {
 namespace Linux {
 
-Thread::Thread(Process *process, ThreadId tid) : super(process, tid) {}
+Thread::Thread(Process *process, ThreadId tid)
+    : super(process, tid), _groupStopped(false) {}
 
 ErrorCode Thread::updateStopInfo(int waitStatus) {
   super::updateStopInfo(waitStatus);
+  _groupStopped = false;
 
   switch (_stopInfo.event) {
   case StopInfo::kEventExit:
@@ -66,6 +68,39 @@ ErrorCode Thread::updateStopInfo(int waitStatus) {
     //     mark the thread as stopped for a trap;
     // (5) the inferior received a SIGTRAP. This is usually because of a
     //     breakpoint, single step or such;
+    // (6) in seize mode, the thread reports a PTRACE_EVENT_STOP instead of
+    //     the SIGSTOP of (2) and (3). We report it as that SIGSTOP: stopped
+    //     for no reason, unless it answers Process::interrupt(), in which
+    //     case it is a signal stop. Other stops, like a clone event, leave the
+    //     interrupt pending: Process::wait() clears it once it reports a stop;
+    // (7) in seize mode, the thread called exec(2) and reports a
+    //     PTRACE_EVENT_EXEC instead of a SIGTRAP;
+    // (8) in seize mode, a group-stop (the whole process got SIGSTOP,
+    //     SIGTSTP, SIGTTIN or SIGTTOU, and we let it through) is also a
+    //     PTRACE_EVENT_STOP, but with the stop signal in place of SIGTRAP.
+    //     Unless it answers an interrupt, the thread is stopped for no
+    //     reason, and resume() parks it until the process gets a SIGCONT.
+
+    if (waitStatus >> 16 == PTRACE_EVENT_STOP) {
+      switch (_stopInfo.signal) {
+      case SIGSTOP:
+      case SIGTSTP:
+      case SIGTTIN:
+      case SIGTTOU: // (8)
+        _groupStopped = true;
+        break;
+      default: // (6)
+        _stopInfo.signal = SIGSTOP;
+        break;
+      }
+
+      if (process()->answersInterrupt(tid())) {
+        _stopInfo.reason = StopInfo::kReasonSignalStop;
+      } else {
+        _stopInfo.event = StopInfo::kEventNone;
+      }
+      return kSuccess;
+    }
 
     siginfo_t si;
     ProcessThreadId ptid(process()->pid(), tid());
@@ -79,6 +114,8 @@ ErrorCode Thread::updateStopInfo(int waitStatus) {
     if (waitStatus >> 8 == (SIGTRAP | (PTRACE_EVENT_CLONE << 8))) { // (1)
       _stopInfo.event = StopInfo::kEventNone;
       _stopInfo.reason = StopInfo::kReasonThreadSpawn;
+    } else if (waitStatus >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) { // (7)
+      _stopInfo.reason = StopInfo::kReasonTrap;
     } else if (si.si_code == SI_TKILL && si.si_pid == getpid()) { // (2)
       // The only signal we are supposed to send to the inferior is a SIGSTOP.
       DS2ASSERT(_stopInfo.signal == SIGSTOP);
@@ -129,54 +166,110 @@ ErrorCode Thread::updateStopInfo(int waitStatus) {
   return kSuccess;
 }
 
+ErrorCode Thread::suspend() {
+  //
+  // The thread may have stopped or exited on its own since we last heard from
+  // it, e.g. by hitting a breakpoint at the same time as the thread we are
+  // stopping the process for. Collect that event rather than queueing a
+  // SIGSTOP it would only report once resumed.
+  //
+  if (_state == kRunning) {
+    int status;
+    pid_t ret = ::waitpid(tid(), &status, __WALL | WNOHANG);
+    if (ret == tid()) {
+      DS2LOG(Debug, "tid %" PRI_PID " already stopped: %s", tid(),
+             Stringify::WaitStatus(status));
+      updateStopInfo(status);
+    } else if (isZombieLeader()) {
+      _state = kTerminated;
+    }
+  }
+
+  return super::suspend();
+}
+
+//
+// A thread resumed from a group-stop would run while the rest of the process
+// is stopped; leave it in the group-stop instead, as the kernel would if we
+// weren't tracing it. Injecting a signal or stepping resumes it for real.
+//
+ErrorCode Thread::resume(int signal, Address const &address) {
+  if (!_groupStopped || signal != 0 || address.valid() ||
+      (_state != kStopped && _state != kStepped)) {
+    return super::resume(signal, address);
+  }
+
+  DS2LOG(Debug, "tid %" PRI_PID " stays in group-stop", tid());
+
+  invalidateCPUState();
+  CHK(process()->ptrace().listen(ProcessThreadId(process()->pid(), tid())));
+  _state = kRunning;
+  _stopInfo.signal = 0;
+  return kSuccess;
+}
+
+//
+// A thread group leader that exited while other threads live on stays a
+// zombie, and waitpid(2) won't report it until the other threads are gone;
+// waiting for it to acknowledge a SIGSTOP would block forever.
+//
+bool Thread::isZombieLeader() const {
+  if (tid() != _process->pid())
+    return false;
+
+  ProcFS::Stat stat;
+  if (!ProcFS::ReadStat(_process->pid(), tid(), stat))
+    return false;
+
+  return stat.state == Host::Linux::kProcStateZombie ||
+         stat.state == Host::Linux::kProcStateDead;
+}
+
+//
+// Thread state is maintained from the events we get out of waitpid(2) and
+// from our own resume and suspend requests, so enumerating threads doesn't
+// need to ask the kernel anything. When state checking is enabled, each
+// enumeration cross-checks with procfs instead, and a mismatch is fatal.
+//
 void Thread::updateState() {
-  if (!process()->isAlive()) {
-    _state = kTerminated;
-    return;
+  if (sStateChecking && !reconcileState()) {
+    DS2BUG("lost track of the state of tid %" PRI_PID, tid());
   }
+}
 
+//
+// Compares our view of the thread with /proc/pid/task/tid/stat, and records
+// the core it last ran on. A thread we believe to be running may already
+// have stopped or exited without us having waited for it yet, and a stopped
+// thread can still be killed; but a thread we hold in a ptrace stop can't be
+// running. Returns false when that happens, which means we lost an event.
+//
+bool Thread::reconcileState() {
   ProcFS::Stat stat;
   if (!ProcFS::ReadStat(_process->pid(), tid(), stat)) {
-    stat.task_cpu = 0;
-    stat.state = 0;
+    return true;
   }
 
   _stopInfo.core = stat.task_cpu;
 
-  State oldState = _state;
-
   switch (stat.state) {
-  case Host::Linux::kProcStateZombie:
-  case Host::Linux::kProcStateDead:
-    _state = kTerminated;
-    break;
-
   case Host::Linux::kProcStateUninterruptible:
   case Host::Linux::kProcStateSleeping:
   case Host::Linux::kProcStateRunning:
   case Host::Linux::kProcStatePaging:
-    _state = kRunning;
+    if (_state == kStopped) {
+      DS2LOG(Error,
+             "tid %" PRI_PID " is %s but the kernel reports state '%c'",
+             tid(), Stringify::ThreadState(_state), stat.state);
+      return false;
+    }
     break;
 
-  case Host::Linux::kProcStateTraced:
-  case Host::Linux::kProcStateStopped:
-    _state = kStopped;
-    break;
   default:
-    _state = kInvalid;
     break;
   }
 
-  // If the thread state has gone from running to a non-running state,
-  // update the stop info, to maintain consistentency between
-  // the state and the stop info.
-  if (oldState == kRunning && _state != kRunning) {
-    int status;
-    int ret = ::waitpid(tid(), &status, __WALL | WNOHANG);
-    DS2ASSERT(ret >= 0);
-
-    updateStopInfo(status);
-  }
+  return true;
 }
 } // namespace Linux
 } // namespace Target
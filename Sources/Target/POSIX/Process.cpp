@@ -140,6 +140,7 @@ ds2::Target::Process *Process::Attach(ProcessId pid) {
 ds2::Target::Process *Process::Create(ProcessSpawner &spawner) {
   auto process = ds2::make_unique<Target::Process>();
 
+  process->prepareSpawner(spawner);
   if (spawner.run([&process]() {
         return process->ptrace().traceMe(true) == kSuccess;
       }) != kSuccess) {
@@ -10,6 +10,7 @@
 #endif
 #include "DebugServer2/Target/Process.h"
 
+#include <cstring>
 #include <sys/wait.h>
 
 #define super ds2::Target::ThreadBase
@@ -22,26 +23,71 @@ Thread::Thread(ds2::Target::Process *process, ThreadId tid)
     : super(process, tid) {}
 
 ErrorCode Thread::readCPUState(Architecture::CPUState &state) {
-  // TODO cache CPU state
-  ProcessInfo info;
+  return readCPUStateSets(state, Architecture::kRegisterSetAll);
+}
 
-  CHK(_process->getInfo(info));
-  CHK(process()->ptrace().readCPUState(ProcessThreadId(process()->pid(), tid()),
-                                       info, state));
+ErrorCode Thread::writeCPUState(Architecture::CPUState const &state) {
+  // States that were filled by hand rather than read from the thread don't
+  // say what they contain; write all of it back in that case.
+  uint32_t sets = state.populatedSets;
+  if (sets == Architecture::kRegisterSetNone) {
+    sets = Architecture::kRegisterSetAll;
+  }
+
+  return writeCPUStateSets(state, sets);
+}
+
+ErrorCode Thread::readCPUStateSets(Architecture::CPUState &state,
+                                   uint32_t sets) {
+  // The register state of a stopped thread can only change through us, so
+  // fetch each register set once per stop and serve every subsequent read
+  // from the cache.
+  uint32_t missing = sets & ~_cpuState.populatedSets;
+  if (missing != Architecture::kRegisterSetNone) {
+    ProcessInfo info;
 
+    CHK(_process->getInfo(info));
+    CHK(process()->ptrace().readCPUStateSets(
+        ProcessThreadId(process()->pid(), tid()), info, _cpuState, missing));
+  }
+
+  state = _cpuState;
   return kSuccess;
 }
 
-ErrorCode Thread::writeCPUState(Architecture::CPUState const &state) {
+ErrorCode Thread::writeCPUStateSets(Architecture::CPUState const &state,
+                                    uint32_t sets) {
+  // Most writers do a read-modify-write of the whole state (e.g. to change
+  // the PC); only write back the sets that differ from what the thread has.
+  uint32_t cached = _cpuState.populatedSets & sets;
+  uint32_t dirty = (sets & ~cached) | (state.changedSets(_cpuState) & cached);
+  if (dirty == Architecture::kRegisterSetNone) {
+    return kSuccess;
+  }
+
   ProcessInfo info;
 
   CHK(_process->getInfo(info));
-  CHK(process()->ptrace().writeCPUState(
-      ProcessThreadId(process()->pid(), tid()), info, state));
+  ErrorCode error = process()->ptrace().writeCPUStateSets(
+      ProcessThreadId(process()->pid(), tid()), info, state, dirty);
+  if (error != kSuccess) {
+    // We don't know how much of the state made it to the thread.
+    invalidateCPUState();
+    return error;
+  }
 
+  // The sets we just wrote now match the thread, and so do the sets we had
+  // cached if `state' was read from the cache too.
+  uint32_t valid = sets | (_cpuState.populatedSets & state.populatedSets);
+  _cpuState = state;
+  _cpuState.populatedSets = valid;
   return kSuccess;
 }
 
+void Thread::invalidateCPUState() {
+  _cpuState.populatedSets = Architecture::kRegisterSetNone;
+}
+
 ErrorCode Thread::terminate() {
   return process()->ptrace().kill(ProcessThreadId(process()->pid(), tid()),
                                   SIGKILL);
@@ -82,7 +128,7 @@ ErrorCode Thread::step(int signal, Address const &address) {
 
   // Prepare a software (arch-dependent) single step and resume execution.
   Architecture::CPUState state;
-  CHK(readCPUState(state));
+  CHK(readCPUStateSets(state, Architecture::kRegisterSetGP));
   CHK(PrepareSoftwareSingleStep(
       process(), process()->softwareBreakpointManager(), state, address));
   CHK(resume(signal, address));
@@ -101,6 +147,7 @@ ErrorCode Thread::step(int signal, Address const &address) {
 
   ProcessInfo info;
   CHK(process()->getInfo(info));
+  invalidateCPUState();
   CHK(process()->ptrace().step(ProcessThreadId(process()->pid(), tid()), info,
                                signal, address));
   _state = kStepped;
@@ -113,6 +160,7 @@ ErrorCode Thread::resume(int signal, Address const &address) {
     ProcessInfo info;
 
     CHK(process()->getInfo(info));
+    invalidateCPUState();
     CHK(process()->ptrace().resume(ProcessThreadId(process()->pid(), tid()),
                                    info, signal, address));
     _state = kRunning;
@@ -127,6 +175,9 @@ ErrorCode Thread::resume(int signal, Address const &address) {
 ErrorCode Thread::updateStopInfo(int waitStatus) {
   _stopInfo.clear();
 
+  // A new stop means the thread ran since we last looked at its registers.
+  invalidateCPUState();
+
   if (WIFEXITED(waitStatus)) {
     _stopInfo.event = StopInfo::kEventExit;
     _stopInfo.status = WEXITSTATUS(waitStatus);
@@ -0,0 +1,171 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+#include "DebugServer2/Utils/CRC32.h"
+#include "DebugServer2/Base.h"
+
+#if defined(__GNUC__) &&                                                       \
+    (defined(ARCH_X86_64) || (defined(ARCH_X86) && defined(__SSE2__)))
+#include <immintrin.h>
+#define CRC_USE_PCLMUL
+#endif
+
+namespace ds2 {
+namespace Utils {
+
+namespace {
+
+//
+// Tables for the slicing-by-8 algorithm: kTables[0] is the usual byte-wise
+// table, kTables[k][i] is the CRC of byte i followed by k zero bytes. This
+// lets us fold eight input bytes per iteration with independent lookups.
+//
+struct Tables {
+  uint32_t entries[8][256];
+
+  Tables() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i << 24;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+      }
+      entries[0][i] = crc;
+    }
+
+    for (int k = 1; k < 8; k++) {
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = entries[k - 1][i];
+        entries[k][i] = (crc << 8) ^ entries[0][crc >> 24];
+      }
+    }
+  }
+};
+} // namespace
+
+uint32_t CRC32Scalar(uint32_t crc, void const *data, size_t length) {
+  static Tables const tables;
+  auto const &t = tables.entries;
+  auto bytes = static_cast<uint8_t const *>(data);
+
+  while (length >= 8) {
+    crc ^= (static_cast<uint32_t>(bytes[0]) << 24) |
+           (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+    crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xff] ^ t[5][(crc >> 8) & 0xff] ^
+          t[4][crc & 0xff] ^ t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^
+          t[0][bytes[7]];
+    bytes += 8;
+    length -= 8;
+  }
+
+  while (length-- > 0) {
+    crc = (crc << 8) ^ t[0][(crc >> 24) ^ *bytes++];
+  }
+
+  return crc;
+}
+#if defined(CRC_USE_PCLMUL)
+namespace {
+
+//
+// Multipliers for folding with carry-less multiplications: kFold[k] is x^k
+// modulo the polynomial, so that A * x^k and A * kFold[k] have the same CRC.
+// They are computed once rather than spelled out.
+//
+struct FoldConstants {
+  __m128i by128; // x^192 and x^128, folds one block into the next.
+  __m128i by512; // x^576 and x^512, folds a block four blocks ahead.
+  __m128i swap;  // Byte reversal, the first byte is the most significant.
+
+  static uint64_t XPow(unsigned k) {
+    uint64_t r = 1;
+    while (k-- > 0) {
+      r <<= 1;
+      if (r & (1ULL << 32)) {
+        r ^= 0x104c11db7ULL;
+      }
+    }
+    return r;
+  }
+
+  FoldConstants() {
+    by128 = _mm_set_epi64x(XPow(192), XPow(128));
+    by512 = _mm_set_epi64x(XPow(576), XPow(512));
+    swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  }
+};
+
+//
+// With the block read as a 128-bit polynomial H * x^64 + L, returns
+// H * x^(k + 64) + L * x^k reduced to at most 96 bits, which is congruent to
+// the block shifted by k bits.
+//
+__attribute__((target("pclmul,ssse3"))) inline __m128i Fold(__m128i block,
+                                                            __m128i k) {
+  return _mm_xor_si128(_mm_clmulepi64_si128(block, k, 0x11),
+                       _mm_clmulepi64_si128(block, k, 0x00));
+}
+
+__attribute__((target("pclmul,ssse3"))) inline __m128i
+Load(uint8_t const *bytes, __m128i swap) {
+  return _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<__m128i const *>(bytes)), swap);
+}
+} // namespace
+
+//
+// Folds the input 64 bytes at a time in four independent lanes, then the
+// lanes and the remaining blocks into a single 128-bit value that has the
+// same CRC as everything it consumed. That value and the tail then go
+// through the table-driven code.
+//
+__attribute__((target("pclmul,ssse3"))) static uint32_t
+CRC32PCLMUL(uint32_t crc, uint8_t const *bytes, size_t length) {
+  static FoldConstants const c;
+
+  __m128i x[4];
+  for (int n = 0; n < 4; n++) {
+    x[n] = Load(bytes + 16 * n, c.swap);
+  }
+  x[0] = _mm_xor_si128(x[0], _mm_set_epi32(crc, 0, 0, 0));
+  bytes += 64;
+  length -= 64;
+
+  for (; length >= 64; bytes += 64, length -= 64) {
+    for (int n = 0; n < 4; n++) {
+      x[n] = _mm_xor_si128(Fold(x[n], c.by512), Load(bytes + 16 * n, c.swap));
+    }
+  }
+
+  __m128i acc = x[0];
+  for (int n = 1; n < 4; n++) {
+    acc = _mm_xor_si128(Fold(acc, c.by128), x[n]);
+  }
+
+  for (; length >= 16; bytes += 16, length -= 16) {
+    acc = _mm_xor_si128(Fold(acc, c.by128), Load(bytes, c.swap));
+  }
+
+  uint8_t folded[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(folded),
+                   _mm_shuffle_epi8(acc, c.swap));
+  crc = CRC32Scalar(0, folded, sizeof(folded));
+  return CRC32Scalar(crc, bytes, length);
+}
+#endif
+
+uint32_t CRC32(uint32_t crc, void const *data, size_t length) {
+#if defined(CRC_USE_PCLMUL)
+  static bool const hasPCLMUL = __builtin_cpu_supports("pclmul") &&
+                                __builtin_cpu_supports("ssse3");
+  if (hasPCLMUL && length >= 64)
+    return CRC32PCLMUL(crc, static_cast<uint8_t const *>(data), length);
+#endif
+
+  return CRC32Scalar(crc, data, length);
+}
+} // namespace Utils
+} // namespace ds2
@@ -0,0 +1,292 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+#include "DebugServer2/Types.h"
+#include "DebugServer2/Utils/HexValues.h"
+
+#if defined(ARCH_X86_64) || (defined(ARCH_X86) && defined(__SSE2__))
+#include <emmintrin.h>
+#define HEX_USE_SSE2
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define HEX_USE_AVX2
+#endif
+#elif defined(ARCH_ARM64)
+#include <arm_neon.h>
+#define HEX_USE_NEON
+#endif
+
+namespace ds2 {
+
+#if defined(HEX_USE_AVX2)
+//
+// AVX2 is not part of the baseline, these are only called once we know the
+// CPU has it. They go through 32 bytes at a time and return the number of
+// bytes they converted.
+//
+__attribute__((target("avx2"))) static size_t
+HexEncodeAVX2(char *out, uint8_t const *in, size_t length) {
+  __m256i const mask = _mm256_set1_epi8(0x0f);
+  __m256i const digits =
+      _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a',
+                       'b', 'c', 'd', 'e', 'f', '0', '1', '2', '3', '4', '5',
+                       '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+
+  size_t done = 0;
+  for (; length - done >= 32; done += 32) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + done));
+    __m256i hi = _mm256_shuffle_epi8(
+        digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+    __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, mask));
+
+    // Interleaving works within 128-bit lanes; put the halves back in order.
+    __m256i first = _mm256_unpacklo_epi8(hi, lo);
+    __m256i second = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * done),
+                        _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * done + 32),
+                        _mm256_permute2x128_si256(first, second, 0x31));
+  }
+
+  return done;
+}
+
+__attribute__((target("avx2"))) static inline bool
+HexToNibblesAVX2(__m256i chars, __m256i &nibbles) {
+  __m256i const minusOne = _mm256_set1_epi8(-1);
+
+  __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+  __m256i isDigit =
+      _mm256_and_si256(_mm256_cmpgt_epi8(digit, minusOne),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8(10), digit));
+
+  __m256i alpha =
+      _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)),
+                      _mm256_set1_epi8('a'));
+  __m256i isAlpha =
+      _mm256_and_si256(_mm256_cmpgt_epi8(alpha, minusOne),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8(6), alpha));
+
+  if (_mm256_movemask_epi8(_mm256_or_si256(isDigit, isAlpha)) != -1)
+    return false;
+
+  nibbles = _mm256_or_si256(
+      _mm256_and_si256(isDigit, digit),
+      _mm256_and_si256(isAlpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+  return true;
+}
+
+__attribute__((target("avx2"))) static size_t
+HexDecodeAVX2(uint8_t *bytes, char const *chars, size_t length) {
+  // Each pair of nibbles becomes hi * 16 + lo in a 16-bit lane.
+  __m256i const weights = _mm256_set1_epi16(0x0110);
+
+  size_t done = 0;
+  for (; length - done >= 32; done += 32) {
+    __m256i first, second;
+    if (!HexToNibblesAVX2(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(
+                              chars + 2 * done)),
+                          first) ||
+        !HexToNibblesAVX2(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(
+                              chars + 2 * done + 32)),
+                          second))
+      break;
+
+    __m256i packed =
+        _mm256_packus_epi16(_mm256_maddubs_epi16(first, weights),
+                            _mm256_maddubs_epi16(second, weights));
+    // Packing works within 128-bit lanes too.
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(bytes + done),
+                        _mm256_permute4x64_epi64(packed, 0xd8));
+  }
+
+  return done;
+}
+
+static bool HasAVX2() {
+  static bool const hasAVX2 = __builtin_cpu_supports("avx2");
+  return hasAVX2;
+}
+#endif
+
+void HexEncodeScalar(char *out, void const *data, size_t length) {
+  uint8_t const *in = static_cast<uint8_t const *>(data);
+
+  for (; length > 0; length--, in++) {
+    *out++ = NibbleToHex(*in >> 4);
+    *out++ = NibbleToHex(*in & 0x0f);
+  }
+}
+
+void HexDecodeScalar(void *out, char const *chars, size_t length) {
+  uint8_t *bytes = static_cast<uint8_t *>(out);
+
+  for (; length > 0; length--, chars += 2) {
+    *bytes++ = HexToByte(chars);
+  }
+}
+
+void HexEncode(char *out, void const *data, size_t length) {
+  uint8_t const *in = static_cast<uint8_t const *>(data);
+
+#if defined(HEX_USE_AVX2)
+  if (HasAVX2()) {
+    size_t done = HexEncodeAVX2(out, in, length);
+    in += done;
+    out += 2 * done;
+    length -= done;
+  }
+#endif
+
+#if defined(HEX_USE_SSE2)
+  //
+  // Split 16 bytes into high and low nibbles, turn each nibble into its ASCII
+  // digit ('0' + n, plus 'a' - '0' - 10 when n > 9) and interleave them.
+  //
+  __m128i const mask = _mm_set1_epi8(0x0f);
+  __m128i const nine = _mm_set1_epi8(9);
+  __m128i const zero = _mm_set1_epi8('0');
+  __m128i const alpha = _mm_set1_epi8('a' - '0' - 10);
+
+  for (; length >= 16; length -= 16, in += 16, out += 32) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    __m128i lo = _mm_and_si128(v, mask);
+
+    hi = _mm_add_epi8(_mm_add_epi8(hi, zero),
+                      _mm_and_si128(_mm_cmpgt_epi8(hi, nine), alpha));
+    lo = _mm_add_epi8(_mm_add_epi8(lo, zero),
+                      _mm_and_si128(_mm_cmpgt_epi8(lo, nine), alpha));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                     _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16),
+                     _mm_unpackhi_epi8(hi, lo));
+  }
+#elif defined(HEX_USE_NEON)
+  uint8x16_t const mask = vdupq_n_u8(0x0f);
+  uint8x16_t const nine = vdupq_n_u8(9);
+  uint8x16_t const zero = vdupq_n_u8('0');
+  uint8x16_t const alpha = vdupq_n_u8('a' - '0' - 10);
+
+  for (; length >= 16; length -= 16, in += 16, out += 32) {
+    uint8x16_t v = vld1q_u8(in);
+    uint8x16x2_t digits;
+    digits.val[0] = vshrq_n_u8(v, 4);
+    digits.val[1] = vandq_u8(v, mask);
+
+    for (int n = 0; n < 2; n++) {
+      digits.val[n] =
+          vaddq_u8(vaddq_u8(digits.val[n], zero),
+                   vandq_u8(vcgtq_u8(digits.val[n], nine), alpha));
+    }
+
+    vst2q_u8(reinterpret_cast<uint8_t *>(out), digits);
+  }
+#endif
+
+  HexEncodeScalar(out, in, length);
+}
+
+#if defined(HEX_USE_SSE2)
+//
+// Converts 16 hex chars to their nibble values. Returns false if any of the
+// chars is not a hex digit; signed comparisons are fine since only bytes in
+// '0'..'9' and 'a'..'f' (once lowercased) can land in the tested ranges.
+//
+static inline bool HexToNibbles(__m128i chars, __m128i &nibbles) {
+  __m128i const minusOne = _mm_set1_epi8(-1);
+
+  __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+  __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(digit, minusOne),
+                                  _mm_cmplt_epi8(digit, _mm_set1_epi8(10)));
+
+  __m128i alpha = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)),
+                               _mm_set1_epi8('a'));
+  __m128i isAlpha = _mm_and_si128(_mm_cmpgt_epi8(alpha, minusOne),
+                                  _mm_cmplt_epi8(alpha, _mm_set1_epi8(6)));
+
+  if (_mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha)) != 0xffff)
+    return false;
+
+  nibbles = _mm_or_si128(
+      _mm_and_si128(isDigit, digit),
+      _mm_and_si128(isAlpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+  return true;
+}
+
+//
+// Combines pairs of nibbles (high first) into 8 bytes held in 16-bit lanes.
+//
+static inline __m128i NibblesToBytes(__m128i nibbles) {
+  __m128i hi = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)),
+                              4);
+  __m128i lo = _mm_srli_epi16(nibbles, 8);
+  return _mm_or_si128(hi, lo);
+}
+#elif defined(HEX_USE_NEON)
+static inline bool HexToNibbles(uint8x16_t chars, uint8x16_t &nibbles) {
+  uint8x16_t digit = vsubq_u8(chars, vdupq_n_u8('0'));
+  uint8x16_t isDigit = vcltq_u8(digit, vdupq_n_u8(10));
+
+  uint8x16_t alpha =
+      vsubq_u8(vorrq_u8(chars, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+  uint8x16_t isAlpha = vcltq_u8(alpha, vdupq_n_u8(6));
+
+  if (vminvq_u8(vorrq_u8(isDigit, isAlpha)) != 0xff)
+    return false;
+
+  nibbles = vbslq_u8(isDigit, digit, vaddq_u8(alpha, vdupq_n_u8(10)));
+  return true;
+}
+#endif
+
+void HexDecode(void *out, char const *chars, size_t length) {
+  uint8_t *bytes = static_cast<uint8_t *>(out);
+
+#if defined(HEX_USE_AVX2)
+  if (HasAVX2()) {
+    size_t done = HexDecodeAVX2(bytes, chars, length);
+    bytes += done;
+    chars += 2 * done;
+    length -= done;
+  }
+#endif
+
+#if defined(HEX_USE_SSE2)
+  for (; length >= 16; length -= 16, chars += 32, bytes += 16) {
+    __m128i first, second;
+    if (!HexToNibbles(
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(chars)),
+            first) ||
+        !HexToNibbles(
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(chars + 16)),
+            second))
+      break;
+
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(bytes),
+        _mm_packus_epi16(NibblesToBytes(first), NibblesToBytes(second)));
+  }
+#elif defined(HEX_USE_NEON)
+  for (; length >= 16; length -= 16, chars += 32, bytes += 16) {
+    uint8x16x2_t pairs = vld2q_u8(reinterpret_cast<uint8_t const *>(chars));
+    uint8x16_t hi, lo;
+    if (!HexToNibbles(pairs.val[0], hi) || !HexToNibbles(pairs.val[1], lo))
+      break;
+
+    vst1q_u8(bytes, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+  }
+#endif
+
+  //
+  // Whatever is left, including blocks with invalid chars, goes through the
+  // scalar path.
+  //
+  HexDecodeScalar(bytes, chars, length);
+}
+} // namespace ds2
@@ -5,14 +5,20 @@
 // source tree.
 
 #include "DebugServer2/Core/BreakpointManager.h"
+#include "DebugServer2/Core/SessionLoop.h"
 #include "DebugServer2/Core/SessionThread.h"
 #include "DebugServer2/GDBRemote/DebugSessionImpl.h"
 #include "DebugServer2/GDBRemote/PlatformSessionImpl.h"
 #include "DebugServer2/GDBRemote/ProtocolHelpers.h"
 #include "DebugServer2/GDBRemote/SlaveSessionImpl.h"
 #include "DebugServer2/Host/Platform.h"
+#if defined(OS_LINUX)
+#include "DebugServer2/Host/Linux/PTrace.h"
+#include "DebugServer2/Host/Linux/SharedMemoryChannel.h"
+#endif
 #include "DebugServer2/Host/QueueChannel.h"
 #include "DebugServer2/Host/Socket.h"
+#include "DebugServer2/Target/Thread.h"
 #include "DebugServer2/Utils/Daemon.h"
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/OptParse.h"
@@ -33,8 +39,8 @@
 using ds2::GDBRemote::DebugSessionImpl;
 using ds2::GDBRemote::PlatformSessionImpl;
 using ds2::GDBRemote::Session;
-using ds2::GDBRemote::SessionDelegate;
 using ds2::GDBRemote::SlaveSessionImpl;
+using ds2::Host::Channel;
 using ds2::Host::Platform;
 using ds2::Host::QueueChannel;
 using ds2::Host::Socket;
@@ -43,6 +49,7 @@ static std::string gDefaultPort = "12345";
 static std::string gDefaultHost = "127.0.0.1";
 static bool gDaemonize = false;
 static bool gGDBCompat = false;
+static bool gRunLengthEncoding = false;
 
 #if defined(OS_POSIX)
 static void CloseFD() {
@@ -179,6 +186,12 @@ static std::unique_ptr<Socket> CreateSocket(std::string const &arg,
 #if defined(OS_POSIX)
   } else if (protocol == "unix" || protocol == "unix-abstract") {
     return CreateUNIXSocket(addrString, protocol == "unix-abstract", reverse);
+#endif
+#if defined(OS_LINUX)
+  } else if (protocol == "shm") {
+    // The shared memory segment is handed over on a UNIX socket, see
+    // CreateSharedMemoryChannel.
+    return CreateUNIXSocket(addrString, false, reverse);
 #endif
   } else {
     DS2LOG(Fatal, "unknown protocol `%s'", protocol.c_str());
@@ -187,13 +200,59 @@ static std::unique_ptr<Socket> CreateSocket(std::string const &arg,
   DS2_UNREACHABLE();
 }
 
-static int RunDebugServer(Socket *socket, SessionDelegate *impl) {
+#if defined(OS_LINUX)
+static bool IsSharedMemoryURL(std::string const &arg) {
+  return arg.compare(0, ::strlen("shm://"), "shm://") == 0;
+}
+
+static std::unique_ptr<Channel>
+CreateSharedMemoryChannel(std::unique_ptr<Socket> client) {
+  if (!client) {
+    DS2LOG(Fatal, "no shared memory client");
+  }
+
+  std::unique_ptr<Channel> channel =
+      ds2::Host::Linux::SharedMemoryChannel::Create(std::move(client));
+  if (!channel) {
+    DS2LOG(Fatal, "cannot set up shared memory channel");
+  }
+
+  return channel;
+}
+#endif
+
+static int RunDebugServer(Channel *channel, DebugSessionImpl *impl) {
   Session session(gGDBCompat ? ds2::GDBRemote::kCompatibilityModeGDB
                              : ds2::GDBRemote::kCompatibilityModeLLDB);
-  QueueChannel qchannel(socket);
+
+#if defined(OS_LINUX)
+  //
+  // When the channel has a descriptor, the process event loop watches it
+  // along with the inferior, and everything happens on this thread.
+  //
+  if (channel->descriptor() >= 0) {
+    SessionLoop loop(channel, &session);
+
+    session.setDelegate(impl);
+    session.setRunLengthEncoding(gRunLengthEncoding);
+    session.create(channel);
+    impl->watchDescriptor(channel->descriptor(),
+                          [&loop]() { return loop.pump(); });
+
+    DS2LOG(Debug, "Debug session starting");
+    loop.run();
+    DS2LOG(Debug, "Debug session ended");
+
+    impl->watchDescriptor(-1, nullptr);
+    return EXIT_SUCCESS;
+  }
+#endif
+
+  QueueChannel qchannel(channel);
   SessionThread thread(&qchannel, &session);
 
   session.setDelegate(impl);
+  session.setRunLengthEncoding(gRunLengthEncoding);
   session.create(&qchannel);
 
   DS2LOG(Debug, "Debug session starting");
@@ -262,6 +321,12 @@ static int GdbserverMain(int argc, char **argv) {
                  "remove an element from the environment before lauch");
   opts.addOption(ds2::OptParse::stringOption, "attach", 'a',
                  "attach to the name or PID specified");
+  opts.addOption(ds2::OptParse::boolOption, "check-thread-state", 'T',
+                 "cross-check tracked thread state with the system (slow)");
+#if defined(OS_LINUX)
+  opts.addOption(ds2::OptParse::boolOption, "ptrace-seize", 'P',
+                 "trace with PTRACE_SEIZE and stop with PTRACE_INTERRUPT");
+#endif
 
   // lldb-server compatibility options.
   opts.addOption(ds2::OptParse::boolOption, "gdb-compat", 'g',
@@ -282,6 +347,10 @@ static int GdbserverMain(int argc, char **argv) {
   opts.addOption(ds2::OptParse::boolOption, "once", 'O',
                  "exit after one execution of inferior (default)", true);
 
+  // Protocol options.
+  opts.addOption(ds2::OptParse::boolOption, "run-length-encoding", 'L',
+                 "compress repeated data in replies");
+
   // [host]:port positional argument.
   opts.addPositional("[host]:port", "the [host]:port to connect to");
 
@@ -329,6 +398,11 @@ static int GdbserverMain(int argc, char **argv) {
                       : atoi(opts.getString("attach").c_str());
 
   gGDBCompat = opts.getBool("gdb-compat");
+  gRunLengthEncoding = opts.getBool("run-length-encoding");
+  ds2::Target::Thread::SetStateChecking(opts.getBool("check-thread-state"));
+#if defined(OS_LINUX)
+  ds2::Host::Linux::PTrace::SetSeizeMode(opts.getBool("ptrace-seize"));
+#endif
   if (gGDBCompat && args.empty() && attachPid < 0) {
     // In GDB compatibility mode, we need a process to attach to or a command
     // line so we can launch it.
@@ -397,6 +471,14 @@ static int GdbserverMain(int argc, char **argv) {
   else
     impl = ds2::make_unique<DebugSessionImpl>();
 
+#if defined(OS_LINUX)
+  if (fd < 0 && IsSharedMemoryURL(opts.getPositional("[host]:port"))) {
+    auto channel = CreateSharedMemoryChannel(reverse ? std::move(socket)
+                                                     : socket->accept());
+    return RunDebugServer(channel.get(), impl.get());
+  }
+#endif
+
 #if defined(OS_POSIX)
   return RunDebugServer(
       (fd >= 0 || reverse) ? socket.get() : socket->accept().get(), impl.get());
@@ -0,0 +1,367 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+//
+// Microbenchmarks for the code on the path of every packet. Benchmarks of code
+// with a fast path run it and the plain implementation on the same input,
+// check that they agree, and print the throughput of both.
+//
+// Build with -DBENCHMARKS=ON and run `ds2-benchmarks [name...]`.
+//
+
+#include "DebugServer2/GDBRemote/PacketProcessor.h"
+#include "DebugServer2/Utils/CRC32.h"
+#include "DebugServer2/Utils/HexValues.h"
+#if defined(OS_LINUX)
+#include "SharedMemoryClient.h"
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+//
+// Runs `body' until at least 200ms went by and returns the number of bytes
+// it processed per second, `bytes' being what one run goes through.
+//
+double Measure(size_t bytes, std::function<void()> const &body) {
+  typedef std::chrono::steady_clock Clock;
+
+  body(); // Warm up caches and lazily built tables.
+
+  size_t runs = 0;
+  auto start = Clock::now();
+  std::chrono::duration<double> elapsed;
+  do {
+    body();
+    runs++;
+    elapsed = Clock::now() - start;
+  } while (elapsed.count() < 0.2);
+
+  return bytes * runs / elapsed.count();
+}
+
+void Report(char const *name, char const *variant, double rate) {
+  std::printf("%-12s %-10s %10.1f MB/s\n", name, variant, rate / 1e6);
+}
+
+Bytes RandomBytes(size_t length) {
+  Bytes bytes(length);
+  for (auto &byte : bytes) {
+    byte = static_cast<uint8_t>(std::rand());
+  }
+  return bytes;
+}
+
+// Sinks for results, so that the compiler can't drop the work.
+volatile uint32_t gSink;
+
+bool BenchmarkCRC32() {
+  Bytes data = RandomBytes(1 << 20);
+
+  if (ds2::Utils::CRC32(0xffffffff, data.data(), data.size()) !=
+      ds2::Utils::CRC32Scalar(0xffffffff, data.data(), data.size()))
+    return false;
+
+  Report("crc32", "scalar", Measure(data.size(), [&]() {
+           gSink = ds2::Utils::CRC32Scalar(0xffffffff, data.data(),
+                                           data.size());
+         }));
+  Report("crc32", "dispatch", Measure(data.size(), [&]() {
+           gSink = ds2::Utils::CRC32(0xffffffff, data.data(), data.size());
+         }));
+  return true;
+}
+
+bool BenchmarkHex() {
+  Bytes data = RandomBytes(1 << 16);
+  std::string fast(2 * data.size(), '\0');
+  std::string plain(2 * data.size(), '\0');
+
+  ds2::HexEncode(&fast[0], data.data(), data.size());
+  ds2::HexEncodeScalar(&plain[0], data.data(), data.size());
+  if (fast != plain)
+    return false;
+
+  Report("hex-encode", "scalar", Measure(data.size(), [&]() {
+           ds2::HexEncodeScalar(&plain[0], data.data(), data.size());
+         }));
+  Report("hex-encode", "dispatch", Measure(data.size(), [&]() {
+           ds2::HexEncode(&fast[0], data.data(), data.size());
+         }));
+
+  Bytes decoded(data.size());
+  ds2::HexDecode(decoded.data(), plain.data(), decoded.size());
+  if (decoded != data)
+    return false;
+
+  Report("hex-decode", "scalar", Measure(data.size(), [&]() {
+           ds2::HexDecodeScalar(decoded.data(), plain.data(), decoded.size());
+         }));
+  Report("hex-decode", "dispatch", Measure(data.size(), [&]() {
+           ds2::HexDecode(decoded.data(), plain.data(), decoded.size());
+         }));
+  return true;
+}
+
+class PacketSink : public ds2::GDBRemote::PacketProcessorDelegate {
+public:
+  size_t packets = 0;
+  size_t invalid = 0;
+
+  void onPacketData(std::string const &data, bool valid) override {
+    packets++;
+    invalid += !valid;
+    gSink += static_cast<uint32_t>(data.size());
+  }
+
+  void onInvalidData(std::string const &) override { invalid++; }
+};
+
+void AppendPacket(std::string &stream, std::string const &payload) {
+  uint8_t csum = 0;
+  for (char c : payload) {
+    csum += static_cast<uint8_t>(c);
+  }
+
+  stream += '$';
+  stream += payload;
+  stream += '#';
+  stream += ds2::NibbleToHex(csum >> 4);
+  stream += ds2::NibbleToHex(csum & 0x0f);
+}
+
+//
+// A client-to-server stream shaped like what LLDB sends while stepping
+// through a program: acks, register and memory reads, breakpoint updates,
+// resumes, and a few large binary memory writes which make up most of the
+// bytes.
+//
+std::string RecordedStream(size_t &packets) {
+  static char const *const kRequests[] = {
+      "qThreadStopInfo1f2a", "p10;thread:1f2a;", "p6;thread:1f2a;",
+      "p7;thread:1f2a;",     "x7ffd5a3c1e40,200", "x555555556040,40",
+      "Z0,555555555149,1",   "vCont;s:1f2a",      "z0,555555555149,1",
+      "qMemoryRegionInfo:7ffd5a3c1e40",
+      "jThreadsInfo",        "vCont;c",
+  };
+
+  Bytes data = RandomBytes(4096);
+  std::string escaped;
+  for (uint8_t byte : data) {
+    if (byte == '$' || byte == '#' || byte == '}' || byte == '*') {
+      escaped += '}';
+      byte ^= 0x20;
+    }
+    escaped += static_cast<char>(byte);
+  }
+
+  std::string stream;
+  packets = 0;
+  for (int round = 0; round < 64; round++) {
+    for (auto request : kRequests) {
+      stream += '+';
+      AppendPacket(stream, request);
+      packets += 2;
+    }
+    if (round % 4 == 0) {
+      AppendPacket(stream, "X7ffff7dd1000,1000:" + escaped);
+      packets++;
+    }
+  }
+
+  return stream;
+}
+
+//
+// Feeds the stream to the parser in reads of various sizes, the way it
+// comes off the socket.
+//
+bool BenchmarkPackets() {
+  size_t expected;
+  std::string stream = RecordedStream(expected);
+
+  static struct {
+    char const *variant;
+    size_t chunk;
+  } const kReads[] = {{"64k-reads", 65536}, {"mtu-reads", 1448},
+                      {"16b-reads", 16}};
+
+  for (auto const &read : kReads) {
+    std::vector<std::string> chunks;
+    for (size_t n = 0; n < stream.size(); n += read.chunk) {
+      chunks.push_back(stream.substr(n, read.chunk));
+    }
+
+    PacketSink sink;
+    ds2::GDBRemote::PacketProcessor processor;
+    processor.setDelegate(&sink);
+    double rate = Measure(stream.size(), [&]() {
+      for (auto const &chunk : chunks) {
+        processor.parse(chunk);
+      }
+    });
+
+    // Measure() makes at least two runs of whole streams.
+    if (sink.invalid != 0 || sink.packets % expected != 0 ||
+        sink.packets < 2 * expected)
+      return false;
+
+    Report("packets", read.variant, rate);
+  }
+
+  return true;
+}
+
+#if defined(OS_LINUX)
+//
+// Connects a SharedMemoryChannel to the reference client over a socket pair.
+//
+std::unique_ptr<ds2::Host::Linux::SharedMemoryChannel>
+ConnectSharedMemory(std::unique_ptr<SharedMemoryClient> &client) {
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+    return nullptr;
+
+  client.reset(new SharedMemoryClient(fds[1]));
+  auto channel = ds2::Host::Linux::SharedMemoryChannel::Create(
+      ds2::make_unique<ds2::Host::Socket>(fds[0]));
+  if (!channel || !client->handshake())
+    return nullptr;
+
+  return channel;
+}
+
+//
+// Receives exactly `length' bytes from the channel.
+//
+bool ReceiveAll(ds2::Host::Channel *channel, uint8_t *data, size_t length) {
+  while (length > 0) {
+    if (!channel->wait())
+      return false;
+
+    ssize_t count = channel->receive(data, length);
+    if (count < 0)
+      return false;
+
+    data += count;
+    length -= count;
+  }
+  return true;
+}
+
+//
+// Sends buffers through the channel to the reference client, which echoes
+// them back. Chunks are sized so that positions wrap around the ring at
+// every offset. Once the round trip checks out, a client moving readPos past
+// writePos, or writePos too far ahead of readPos, must end the session.
+//
+bool BenchmarkSharedMemory() {
+  typedef ds2::Host::Linux::SharedMemoryChannel SharedMemoryChannel;
+
+  std::unique_ptr<SharedMemoryClient> client;
+  auto channel = ConnectSharedMemory(client);
+  if (!channel)
+    return false;
+
+  std::thread echo([&client]() {
+    std::vector<uint8_t> buffer(1 << 16);
+    for (;;) {
+      ssize_t count = client->receive(buffer.data(), buffer.size());
+      if (count <= 0 || !client->send(buffer.data(), count))
+        return;
+    }
+  });
+
+  Bytes data = RandomBytes(65521);
+  Bytes echoed(data.size());
+  bool success = true;
+  auto roundTrip = [&]() {
+    // The payload goes out in two pieces, the way packets are framed.
+    ds2::Host::Channel::Buffer buffers[2] = {
+        {data.data(), 17}, {data.data() + 17, data.size() - 17}};
+    success &= channel->sendv(buffers, 2) &&
+               ReceiveAll(channel.get(), echoed.data(), echoed.size()) &&
+               echoed == data;
+  };
+
+  for (size_t n = 0; n < 4 * SharedMemoryChannel::kRingSize / data.size();
+       n++) {
+    roundTrip();
+  }
+
+  if (success) {
+    Report("shm", "round-trip", Measure(2 * data.size(), roundTrip));
+  }
+
+  // The echo thread stops once the channel is closed.
+  channel->close();
+  echo.join();
+  if (!success)
+    return false;
+
+  channel = ConnectSharedMemory(client);
+  if (!channel)
+    return false;
+  uint32_t position = client->input()->writePos.load();
+  client->input()->readPos.store(position + 1);
+  if (channel->send(data.data(), 1) >= 0 || channel->connected())
+    return false;
+
+  channel = ConnectSharedMemory(client);
+  if (!channel)
+    return false;
+  position = client->output()->readPos.load();
+  client->output()->writePos.store(position + SharedMemoryChannel::kRingSize +
+                                   1);
+  uint8_t byte;
+  return channel->receive(&byte, 1) < 0 && !channel->connected();
+}
+#endif
+
+struct Benchmark {
+  char const *name;
+  bool (*run)();
+};
+
+Benchmark const kBenchmarks[] = {
+    {"crc32", BenchmarkCRC32},
+    {"hex", BenchmarkHex},
+    {"packets", BenchmarkPackets},
+#if defined(OS_LINUX)
+    {"shm", BenchmarkSharedMemory},
+#endif
+};
+} // namespace
+
+int main(int argc, char **argv) {
+  int status = EXIT_SUCCESS;
+
+  for (auto const &benchmark : kBenchmarks) {
+    bool selected = (argc == 1);
+    for (int n = 1; n < argc; n++) {
+      selected |= (std::strcmp(argv[n], benchmark.name) == 0);
+    }
+    if (!selected)
+      continue;
+
+    if (!benchmark.run()) {
+      std::fprintf(stderr, "%s: results differ\n", benchmark.name);
+      status = EXIT_FAILURE;
+    }
+  }
+
+  return status;
+}
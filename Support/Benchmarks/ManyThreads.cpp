@@ -0,0 +1,44 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+//
+// Inferior for Support/Scripts/test-attach-latency.py: starts the requested
+// number of threads, all blocked in pause(2), prints "ready" once they exist
+// and then blocks as well. Thread stacks are kept small so that thousands of
+// threads fit in a modest address space.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <unistd.h>
+
+static void *Sleep(void *) {
+  for (;;) {
+    ::pause();
+  }
+  return nullptr;
+}
+
+int main(int argc, char **argv) {
+  int count = (argc > 1) ? std::atoi(argv[1]) : 8;
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, 64 << 10);
+
+  for (int n = 0; n < count; n++) {
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, Sleep, nullptr) != 0) {
+      std::perror("pthread_create");
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::printf("ready\n");
+  std::fflush(stdout);
+  Sleep(nullptr);
+}
@@ -0,0 +1,259 @@
+// Copyright (c) Meta Platforms, Inc. and affiliates.
+//
+// This source code is licensed under the Apache License v2.0 with LLVM
+// Exceptions found in the LICENSE file in the root directory of this
+// source tree.
+
+#pragma once
+
+//
+// Reference client for the shared memory transport described in
+// DebugServer2/Host/Linux/SharedMemoryChannel.h. It only depends on the
+// layout declared there, and is what a debugger would have to implement to
+// talk to `ds2 gdbserver shm://path'.
+//
+
+#include "DebugServer2/Host/Linux/SharedMemoryChannel.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class SharedMemoryClient {
+public:
+  typedef ds2::Host::Linux::SharedMemoryChannel Layout;
+
+protected:
+  int _socket;
+  bool _closed;
+  void *_base;
+  size_t _mapSize;
+  int _events[2][2];
+  Layout::Ring *_input;
+  Layout::Ring *_output;
+  uint8_t *_inputData;
+  uint8_t *_outputData;
+  uint32_t _ringSize;
+
+public:
+  // Takes ownership of `socket', the client end of the UNIX socket.
+  explicit SharedMemoryClient(int socket)
+      : _socket(socket), _closed(false), _base(MAP_FAILED), _mapSize(0),
+        _events{{-1, -1}, {-1, -1}}, _input(nullptr), _output(nullptr),
+        _inputData(nullptr), _outputData(nullptr), _ringSize(0) {}
+
+  ~SharedMemoryClient() {
+    if (_base != MAP_FAILED) {
+      ::munmap(_base, _mapSize);
+    }
+    for (auto &ring : _events) {
+      for (int fd : ring) {
+        if (fd >= 0) {
+          ::close(fd);
+        }
+      }
+    }
+    ::close(_socket);
+  }
+
+public:
+  // Receives and maps the segment the server passes on connection.
+  bool handshake() {
+    char byte;
+    struct iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+
+    char control[CMSG_SPACE(5 * sizeof(int))];
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t nrecvd;
+    do {
+      nrecvd = ::recvmsg(_socket, &msg, MSG_CMSG_CLOEXEC);
+    } while (nrecvd < 0 && errno == EINTR);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (nrecvd != 1 || cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(5 * sizeof(int)))
+      return false;
+
+    int fds[5];
+    std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    for (size_t n = 0; n < 4; n++) {
+      _events[n / 2][n % 2] = fds[n + 1];
+    }
+
+    struct stat st;
+    bool success = ::fstat(fds[0], &st) == 0;
+    if (success) {
+      _mapSize = st.st_size;
+      _base = ::mmap(nullptr, _mapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fds[0], 0);
+      success = _base != MAP_FAILED;
+    }
+    ::close(fds[0]);
+    if (!success)
+      return false;
+
+    // Don't trust the header any more than the server trusts the positions.
+    auto header = static_cast<Layout::Header *>(_base);
+    _ringSize = header->ringSize;
+    uint32_t dataOffset = header->dataOffset;
+    if (_mapSize < sizeof(Layout::Header) || header->magic != Layout::kMagic ||
+        header->version != Layout::kVersion || _ringSize == 0 ||
+        (_ringSize & (_ringSize - 1)) != 0 ||
+        dataOffset < sizeof(Layout::Header) ||
+        dataOffset + 2 * static_cast<size_t>(_ringSize) > _mapSize)
+      return false;
+
+    _input = &header->rings[Layout::kServerToClient];
+    _output = &header->rings[Layout::kClientToServer];
+    _outputData = static_cast<uint8_t *>(_base) + dataOffset;
+    _inputData = _outputData + _ringSize;
+    return true;
+  }
+
+  inline bool connected() const { return !_closed; }
+
+  inline Layout::Ring *input() const { return _input; }
+  inline Layout::Ring *output() const { return _output; }
+
+public:
+  // Reads at least one byte, blocking until there is some.
+  ssize_t receive(void *buffer, size_t length) {
+    for (;;) {
+      if (_closed)
+        return -1;
+
+      uint32_t readPos = _input->readPos.load(std::memory_order_relaxed);
+      uint32_t writePos = _input->writePos.load(std::memory_order_acquire);
+      if (!checkPositions(readPos, writePos))
+        return -1;
+
+      size_t count = std::min<size_t>(length, writePos - readPos);
+      if (count == 0) {
+        _input->readerWaiting.store(1);
+        if (_input->writePos.load() != writePos) {
+          _input->readerWaiting.store(0);
+        } else if (!sleep(_events[Layout::kServerToClient]
+                                 [Layout::kEventProduced],
+                          _input->readerWaiting)) {
+          return -1;
+        }
+        continue;
+      }
+
+      size_t offset = readPos & (_ringSize - 1);
+      size_t first = std::min<size_t>(count, _ringSize - offset);
+      std::memcpy(buffer, _inputData + offset, first);
+      std::memcpy(static_cast<uint8_t *>(buffer) + first, _inputData,
+                  count - first);
+
+      _input->readPos.store(readPos + count);
+      signal(_events[Layout::kServerToClient][Layout::kEventConsumed],
+             _input->writerWaiting);
+      return count;
+    }
+  }
+
+  // Writes the whole buffer, blocking while the ring is full.
+  bool send(void const *buffer, size_t length) {
+    uint8_t const *data = static_cast<uint8_t const *>(buffer);
+
+    while (length > 0) {
+      if (_closed)
+        return false;
+
+      uint32_t writePos = _output->writePos.load(std::memory_order_relaxed);
+      uint32_t readPos = _output->readPos.load(std::memory_order_acquire);
+      if (!checkPositions(readPos, writePos))
+        return false;
+
+      size_t space = _ringSize - (writePos - readPos);
+      if (space == 0) {
+        _output->writerWaiting.store(1);
+        if (_output->readPos.load() != readPos) {
+          _output->writerWaiting.store(0);
+        } else if (!sleep(_events[Layout::kClientToServer]
+                                 [Layout::kEventConsumed],
+                          _output->writerWaiting)) {
+          return false;
+        }
+        continue;
+      }
+
+      size_t chunk = std::min(length, space);
+      size_t offset = writePos & (_ringSize - 1);
+      size_t first = std::min<size_t>(chunk, _ringSize - offset);
+      std::memcpy(_outputData + offset, data, first);
+      std::memcpy(_outputData, data + first, chunk - first);
+
+      _output->writePos.store(writePos + chunk);
+      signal(_events[Layout::kClientToServer][Layout::kEventProduced],
+             _output->readerWaiting);
+
+      data += chunk;
+      length -= chunk;
+    }
+
+    return true;
+  }
+
+protected:
+  // Same rule as the server: a ring never holds more than ringSize bytes.
+  bool checkPositions(uint32_t readPos, uint32_t writePos) {
+    if (writePos - readPos <= _ringSize)
+      return true;
+
+    _closed = true;
+    ::shutdown(_socket, SHUT_RDWR);
+    return false;
+  }
+
+  bool sleep(int event, std::atomic<uint32_t> &flag) {
+    struct pollfd pfds[2];
+    pfds[0].fd = event;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = _socket;
+    pfds[1].events = POLLIN;
+
+    int nfds;
+    do {
+      pfds[0].revents = pfds[1].revents = 0;
+      nfds = ::poll(pfds, 2, -1);
+    } while (nfds < 0 && errno == EINTR);
+
+    flag.store(0);
+
+    if (pfds[0].revents & POLLIN) {
+      eventfd_t value;
+      ::eventfd_read(event, &value);
+    }
+
+    // The server doesn't write to the socket after the handshake either.
+    if (nfds < 0 || pfds[1].revents != 0) {
+      _closed = true;
+      return false;
+    }
+
+    return true;
+  }
+
+  void signal(int event, std::atomic<uint32_t> const &flag) {
+    if (flag.load() != 0) {
+      ::eventfd_write(event, 1);
+    }
+  }
+};
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+#
+# This source code is licensed under the Apache License v2.0 with LLVM
+# Exceptions found in the LICENSE file in the root directory of this
+# source tree.
+
+#
+# Measures how long ds2 takes to attach to a process with many threads: the
+# time from starting `ds2 gdbserver --attach` to receiving the reply to the
+# first `?` packet, by which point every thread has been stopped.
+#
+# The inferior is ds2-many-threads, built along with ds2-benchmarks when
+# configuring with -DBENCHMARKS=ON. For instance:
+#
+#   ./Support/Scripts/test-attach-latency.py build/ds2 \
+#       build/ds2-many-threads --threads 10 100 1000 5000
+#
+# Extra arguments after `--` are passed to ds2 (e.g. `-- --ptrace-seize`).
+#
+
+import argparse
+import json
+import socket
+import subprocess
+import sys
+import time
+
+
+def frame_packet(message):
+    """
+    Create a framed packet that's ready to send over the GDB connection.
+    """
+    return '$%s#%02x' % (message, sum(message.encode()) % 256)
+
+
+def decode_packet(data):
+    """
+    Undo the escaping and run-length encoding of a packet's contents.
+    """
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        c = data[i]
+        if c == 0x7d:
+            out.append(data[i + 1] ^ 0x20)
+            i += 2
+        elif c == 0x2a:
+            out += out[-1:] * (data[i + 1] - 29)
+            i += 2
+        else:
+            out.append(c)
+            i += 1
+    return out.decode('latin1')
+
+
+class client:
+    """
+    A minimal GDB remote client, enough to talk to a freshly started ds2.
+    """
+
+    def __init__(self, port, timeout):
+        self._socket = None
+        self._received = b''
+        deadline = time.time() + timeout
+        while self._socket is None:
+            try:
+                self._socket = socket.create_connection(('127.0.0.1', port))
+            except OSError:
+                if time.time() > deadline:
+                    raise
+                time.sleep(0.002)
+        self._socket.settimeout(timeout)
+
+    def stop(self):
+        self._socket.close()
+
+    def send_packet(self, packet):
+        self._socket.sendall(frame_packet(packet).encode())
+        return self.receive_response()
+
+    def receive_response(self):
+        while True:
+            self._received = self._received.lstrip(b'+')
+            start = self._received.find(b'$')
+            end = self._received.find(b'#', start)
+            if start >= 0 and end >= 0 and len(self._received) >= end + 3:
+                packet = self._received[start + 1:end]
+                self._received = self._received[end + 3:]
+                self._socket.sendall(b'+')
+                return decode_packet(packet)
+            data = self._socket.recv(65536)
+            if not data:
+                raise EOFError('connection closed by ds2')
+            self._received += data
+
+
+def measure(args, threads, port):
+    inferior = subprocess.Popen([args.inferior, str(threads)],
+                                stdout=subprocess.PIPE)
+    try:
+        if inferior.stdout.readline().strip() != b'ready':
+            raise RuntimeError('%s did not start' % args.inferior)
+        time.sleep(args.settle)
+
+        start = time.time()
+        server = subprocess.Popen([args.ds2, 'gdbserver'] + args.ds2_args +
+                                  ['127.0.0.1:%d' % port,
+                                   '--attach', str(inferior.pid)],
+                                  stdout=subprocess.DEVNULL,
+                                  stderr=subprocess.DEVNULL)
+        try:
+            gdbremote = client(port, args.timeout)
+            reply = gdbremote.send_packet('?')
+            elapsed = time.time() - start
+            if not reply.startswith('T'):
+                raise RuntimeError('unexpected stop reply: %s' % reply[:40])
+
+            # Make sure we did stop every thread.
+            info = json.loads(gdbremote.send_packet('jThreadsInfo'))
+            if len(info) != threads + 1:
+                raise RuntimeError('ds2 reports %d threads, expected %d' %
+                                   (len(info), threads + 1))
+            gdbremote.stop()
+        finally:
+            server.kill()
+            server.wait()
+    finally:
+        inferior.kill()
+        inferior.wait()
+
+    return elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(
+            description='Measure ds2 attach latency against many threads.',
+            epilog='Arguments after -- are passed to ds2.')
+    parser.add_argument('ds2', help='path to the ds2 binary')
+    parser.add_argument('inferior', help='path to ds2-many-threads')
+    parser.add_argument('--threads', type=int, nargs='+',
+                        default=[10, 100, 1000],
+                        help='thread counts to try (default: 10 100 1000)')
+    parser.add_argument('--runs', type=int, default=3,
+                        help='attaches per thread count, the best one is '
+                             'reported (default: 3)')
+    parser.add_argument('--port', type=int, default=23997,
+                        help='port ds2 listens on (default: 23997)')
+    parser.add_argument('--settle', type=float, default=0.5,
+                        help='seconds to let the threads block before '
+                             'attaching (default: 0.5)')
+    parser.add_argument('--timeout', type=float, default=600,
+                        help='seconds to wait for ds2 (default: 600)')
+
+    argv = sys.argv[1:]
+    extra = []
+    if '--' in argv:
+        extra = argv[argv.index('--') + 1:]
+        argv = argv[:argv.index('--')]
+    args = parser.parse_args(argv)
+    args.ds2_args = extra
+
+    for threads in args.threads:
+        best = min(measure(args, threads, args.port)
+                   for _ in range(args.runs))
+        print('threads=%6u: attach=%8.1f ms' % (threads + 1, best * 1000))
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()